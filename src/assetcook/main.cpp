@@ -0,0 +1,339 @@
+// assetcook: imports every model, image and shader layout the application knows how to load into the asset cache of a user
+// profile, without creating a vulkan instance, device or window. run it on a build machine (or before first launch) so that
+// the application starts on a warm cache.
+
+#include <core/application.h>
+#include <core/assert.h>
+#include <core/file.h>
+#include <rhi/image.h>
+#include <rhi/model.h>
+#include <rhi/shader.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <memory>
+#include <print>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <cargs.h>
+#if defined(SPEEDO_USE_MIMALLOC)
+#include <mimalloc.h>
+#endif
+
+namespace assetcook
+{
+
+static std::array gCmdArgs{
+	cag_option{
+		.identifier = 'r',
+		.access_letters = "r",
+		.access_name = "resourcePath",
+		.value_name = "VALUE",
+		.description = "Path to resource directory"
+	},
+	cag_option{
+		.identifier = 'u',
+		.access_letters = "u",
+		.access_name = "userProfilePath",
+		.value_name = "VALUE",
+		.description = "Path to user profile directory, which holds the asset cache"
+	},
+	cag_option{
+		.identifier = 's',
+		.access_letters = "s",
+		.access_name = "sourcePath",
+		.value_name = "VALUE",
+		.description = "Path to directory to import, recursively (default: resource directory)"
+	},
+	cag_option{
+		.identifier = 't',
+		.access_letters = "t",
+		.access_name = "taskTopology",
+		.value_name = "VALUE",
+		.description = "Task thread NUMA topology, e.g. \"0-7,16-23;8-15,24-31\" (default: read from system)"
+	},
+	cag_option{
+		.identifier = 'p',
+		.access_letters = "p",
+		.access_name = "taskPoolCapacity",
+		.value_name = "VALUE",
+		.description = "Tasks in flight before the task pool grows (default: 1024)"
+	},
+	cag_option{
+		.identifier = 'a',
+		.access_letters = "a",
+		.access_name = "taskThreadAffinity",
+		.value_name = "VALUE",
+		.description = "Pin task threads to cpus, 0 or 1 (default: 1)"
+	},
+	cag_option{
+		.identifier = 'b',
+		.access_letters = "b",
+		.access_name = "assetCacheBudget",
+		.value_name = "VALUE",
+		.description = "Asset cache size in MiB, before the least recently used assets are evicted (default: 4096)"
+	},
+	cag_option{
+		.identifier = 'c',
+		.access_letters = "c",
+		.access_name = "assetCacheCompression",
+		.value_name = "VALUE",
+		.description = "Compress new asset cache blobs, 0 or 1 (default: 1)"
+	},
+	cag_option{
+		.identifier = 'v',
+		.access_letters = "v",
+		.access_name = "assetParanoidValidation",
+		.value_name = "VALUE",
+		.description = "Rehash every asset source and cache file on load, 0 or 1 (default: 0)"
+	},
+	cag_option{
+		.identifier = 'h',
+		.access_letters = "h?",
+		.access_name = "help",
+		.description = "Shows the command help"
+	}
+};
+
+// same file types as the open file dialogs of the application
+static constexpr std::array kModelExtensions{".obj"};
+static constexpr std::array kImageExtensions{".jpg", ".jpeg", ".png", ".bmp", ".tga", ".gif", ".psd", ".hdr", ".pic", ".pnm"};
+
+class AssetCook final : public Application
+{
+public:
+	AssetCook(std::string_view name, Environment&& env)
+		: Application(name, std::forward<Environment>(env))
+	{}
+};
+
+struct Job
+{
+	std::string name;
+	std::function<std::error_code()> cook;
+};
+
+struct JobResult
+{
+	std::chrono::steady_clock::duration duration{};
+	std::error_code error;
+};
+
+template <typename T>
+static std::error_code GetError(const std::expected<T, std::error_code>& result) noexcept
+{
+	return result ? std::error_code{} : result.error();
+}
+
+static std::vector<Job> FindJobs(const std::filesystem::path& sourcePath, const Environment& env)
+{
+	std::vector<Job> jobs;
+
+	std::error_code error;
+	for (auto it = std::filesystem::recursive_directory_iterator(sourcePath, error);
+		 !error && it != std::filesystem::recursive_directory_iterator();
+		 it.increment(error))
+	{
+		if (!it->is_regular_file())
+			continue;
+
+		auto filePath = it->path();
+		auto extension = filePath.extension().string();
+		std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return std::tolower(c); });
+
+		if (std::ranges::find(kModelExtensions, extension) != kModelExtensions.end())
+		{
+			jobs.emplace_back(filePath.string(), [filePath]
+			{
+				std::atomic_uint8_t progress = 0;
+				return GetError(model::CookModel<kVk>(filePath, progress));
+			});
+		}
+		else if (std::ranges::find(kImageExtensions, extension) != kImageExtensions.end())
+		{
+			jobs.emplace_back(filePath.string(), [filePath]
+			{
+				std::atomic_uint8_t progress = 0;
+				return GetError(image::CookImage<kVk>(filePath, progress));
+			});
+		}
+	}
+
+	if (error)
+		std::println(stderr, "Failed to walk {}: {}", sourcePath.string(), error.message());
+
+	// the shaders are not resources, and their configurations live in code. compile the same layouts the application creates.
+	auto shaderIncludePath = std::get<std::filesystem::path>(env.variables.at("RootPath")) / "src/rhi/shaders";
+	auto shaderIntermediatePath = std::get<std::filesystem::path>(env.variables.at("UserProfilePath")) / ".slang.intermediate";
+	auto shaderSourceFile = shaderIncludePath / "shaders.slang";
+
+	for (const auto& [layoutName, configuration] : shader::GetLayoutConfigurations<kVk>())
+	{
+		jobs.emplace_back(
+			std::format("{} ({})", shaderSourceFile.string(), layoutName),
+			[shaderIncludePath, shaderIntermediatePath, shaderSourceFile, &configuration]
+			{
+				// one loader per job, since a slang session is not meant to be shared between threads
+				ShaderLoader shaderLoader({shaderIncludePath}, {}, shaderIntermediatePath);
+
+				return GetError(shaderLoader.Cook<kVk>(shaderSourceFile, configuration));
+			});
+	}
+
+	return jobs;
+}
+
+static int Run(const std::filesystem::path& sourcePath, TaskExecutor& executor, const Environment& env)
+{
+	auto jobs = FindJobs(sourcePath, env);
+
+	std::vector<TaskHandle> handles;
+	std::vector<Future<JobResult>> futures;
+	handles.reserve(jobs.size());
+	futures.reserve(jobs.size());
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (const auto& job : jobs)
+	{
+		auto [handle, future] = CreateTask([&job]
+		{
+			auto jobStart = std::chrono::steady_clock::now();
+			auto error = job.cook();
+			return JobResult{.duration = std::chrono::steady_clock::now() - jobStart, .error = error};
+		});
+
+		handles.push_back(handle);
+		futures.push_back(std::move(future));
+	}
+
+	executor.Submit(handles);
+
+	std::size_t failureCount = 0;
+	for (std::size_t jobIt = 0; jobIt < jobs.size(); jobIt++)
+	{
+		auto result = executor.Join(std::move(futures[jobIt]));
+		ENSURE(result);
+
+		auto milliseconds = std::chrono::duration<double, std::milli>(result->duration).count();
+
+		if (result->error)
+		{
+			failureCount++;
+			std::println(stderr, "{:10.1f} ms  {}  FAILED: {}", milliseconds, jobs[jobIt].name, result->error.message());
+		}
+		else
+		{
+			std::println("{:10.1f} ms  {}", milliseconds, jobs[jobIt].name);
+		}
+	}
+
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::println("{} assets in {:.2f} s, {} failed", jobs.size(), seconds, failureCount);
+
+	return failureCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace assetcook
+
+int main(int argc, char* argv[])
+{
+#if defined(SPEEDO_USE_MIMALLOC)
+	mi_version(); // if not called first thing in main(), malloc will not be redirected correctly on windows
+#endif
+
+	using namespace assetcook;
+	using namespace file;
+
+	ENSURE(argv != nullptr);
+
+	const char* resourcePathStr = nullptr;
+	const char* userProfilePathStr = nullptr;
+	const char* sourcePathStr = nullptr;
+	TaskExecutorConfig executorConfig{};
+	AssetConfig assetConfig{};
+
+	cag_option_context cagContext;
+	cag_option_init(&cagContext, gCmdArgs.data(), gCmdArgs.size(), argc, argv);
+
+	while (cag_option_fetch(&cagContext))
+	{
+		switch (cag_option_get_identifier(&cagContext))
+		{
+		case 'u':
+			userProfilePathStr = cag_option_get_value(&cagContext);
+			break;
+		case 'r':
+			resourcePathStr = cag_option_get_value(&cagContext);
+			break;
+		case 's':
+			sourcePathStr = cag_option_get_value(&cagContext);
+			break;
+		case 't':
+			executorConfig.topology = cag_option_get_value(&cagContext);
+			break;
+		case 'p':
+			executorConfig.poolCapacity = static_cast<uint32_t>(std::strtoul(cag_option_get_value(&cagContext), nullptr, 10));
+			break;
+		case 'a':
+			executorConfig.threadAffinity = std::atoi(cag_option_get_value(&cagContext)) != 0 ? kTaskThreadAffinityPinned : kTaskThreadAffinityNone;
+			break;
+		case 'b':
+			assetConfig.cacheBudget = std::strtoull(cag_option_get_value(&cagContext), nullptr, 10) << 20;
+			break;
+		case 'c':
+			assetConfig.cacheCompression = std::atoi(cag_option_get_value(&cagContext)) != 0 ? kAssetCacheCompressionOn : kAssetCacheCompressionOff;
+			break;
+		case 'v':
+			assetConfig.paranoidValidation = std::atoi(cag_option_get_value(&cagContext)) != 0;
+			break;
+		case 'h':
+			std::println("Usage: assetcook [OPTION]...");
+			cag_option_print(gCmdArgs.data(), gCmdArgs.size(), stdout);
+			return EXIT_SUCCESS;
+		default:
+			break;
+		}
+	}
+
+	auto root = GetCanonicalPath(nullptr, "./");
+	ENSURE(root);
+
+	auto resourcePath = GetCanonicalPath(resourcePathStr, (root.value() / "resources").string().c_str());
+	auto userPath = GetCanonicalPath(userProfilePathStr, (root.value() / ".speedo").string().c_str(), true);
+
+	ENSURE(resourcePath);
+	ENSURE(userPath);
+
+	auto sourcePath = GetCanonicalPath(sourcePathStr, resourcePath.value().string().c_str());
+	if (!sourcePath)
+	{
+		std::println(stderr, "Invalid source path: {}", sourcePath.error().message());
+		return EXIT_FAILURE;
+	}
+
+	Environment env{{
+		{"RootPath", root.value()},
+		{"ResourcePath", resourcePath.value()},
+		{"UserProfilePath", userPath.value()}
+	}};
+
+	AddEnvironmentVariables(env, &executorConfig);
+	AddEnvironmentVariables(env, &assetConfig);
+
+	auto app = std::make_shared<AssetCook>("assetcook", std::move(env));
+	gApplication = app;
+
+	return Run(sourcePath.value(), app->GetExecutor(), app->GetEnv());
+}
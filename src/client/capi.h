@@ -21,7 +21,7 @@ extern "C"
 #include <stdbool.h>
 #endif
 
-CLIENT_API void ClientCreate(CreateWindowFunc createWindowFunc, const struct PathConfig* paths);
+CLIENT_API void ClientCreate(CreateWindowFunc createWindowFunc, const struct PathConfig* paths, const struct TaskExecutorConfig* executorConfig, const struct AssetConfig* assetConfig);
 CLIENT_API void ClientDestroy(DestroyWindowFunc destroyWindowFunc);
 CLIENT_API bool ClientMain();
 
@@ -113,6 +113,7 @@ static void Tick()
 	gClientApplication.Read()->Tick();
 
 	auto tickTask = CreateTask(Tick);
+	SetPriority(tickTask.handle, kTaskPriorityCritical);
 	AddDependency(gTickTask.handle, tickTask.handle, true);
 	gTickTask = tickTask;
 }
@@ -131,6 +132,7 @@ static void Draw()
 	gClientApplication.Read()->Draw();
 
 	auto drawTask = CreateTask(Draw);
+	SetPriority(drawTask.handle, kTaskPriorityCritical);
 	AddDependency(gDrawTask.handle, drawTask.handle, true);
 	gDrawTask = drawTask;
 }
@@ -315,8 +317,10 @@ Client::Client(std::string_view name, Environment&& env, CreateWindowFunc create
 	gRpcTask = CreateTask(Rpc, mySocket, myPoller);
 	gRpcTaskState = kTaskStateRunning;
 	gTickTask = CreateTask(client::Tick);
+	SetPriority(gTickTask.handle, kTaskPriorityCritical);
 	gTickTaskState = kTaskStateRunning;
 	gDrawTask = CreateTask(client::Draw);
+	SetPriority(gDrawTask.handle, kTaskPriorityCritical);
 	gDrawTaskState = kTaskStateRunning;
 
 	myTimestamps[0] = std::chrono::high_resolution_clock::now();
@@ -333,7 +337,7 @@ bool ClientMain()
 	return gClientApplication.Read()->Main();
 }
 
-void ClientCreate(CreateWindowFunc createWindowFunc, const PathConfig* paths)
+void ClientCreate(CreateWindowFunc createWindowFunc, const PathConfig* paths, const TaskExecutorConfig* executorConfig, const AssetConfig* assetConfig)
 {
 	using namespace client;
 	using namespace file;
@@ -348,15 +352,17 @@ void ClientCreate(CreateWindowFunc createWindowFunc, const PathConfig* paths)
 	ENSURE(resourcePath);
 	ENSURE(userPath);
 
+	Environment env{{
+		{"RootPath", root.value()},
+		{"ResourcePath", resourcePath.value()},
+		{"UserProfilePath", userPath.value()}
+	}};
+
+	AddEnvironmentVariables(env, executorConfig);
+	AddEnvironmentVariables(env, assetConfig);
+
 	auto appPtr = gClientApplication.Write();
-	appPtr.Get() = std::make_shared<Client>(
-		"client",
-		Environment{{
-			{"RootPath", root.value()},
-			{"ResourcePath", resourcePath.value()},
-			{"UserProfilePath", userPath.value()}
-		}},
-		createWindowFunc);
+	appPtr.Get() = std::make_shared<Client>("client", std::move(env), createWindowFunc);
 
 	std::array<TaskHandle, 3> handles{gRpcTask.handle, gTickTask.handle, gDrawTask.handle};
 	appPtr->GetExecutor().Submit(handles);
@@ -37,6 +37,48 @@ static struct cag_option gCmdArgs[] =
 		.value_name = "VALUE",
 		.description = "Path to user profile directory"
 	},
+	{
+		.identifier = 't',
+		.access_letters = "t",
+		.access_name = "taskTopology",
+		.value_name = "VALUE",
+		.description = "Task thread NUMA topology, e.g. \"0-7,16-23;8-15,24-31\" (default: read from system)"
+	},
+	{
+		.identifier = 'p',
+		.access_letters = "p",
+		.access_name = "taskPoolCapacity",
+		.value_name = "VALUE",
+		.description = "Tasks in flight before the task pool grows (default: 1024)"
+	},
+	{
+		.identifier = 'a',
+		.access_letters = "a",
+		.access_name = "taskThreadAffinity",
+		.value_name = "VALUE",
+		.description = "Pin task threads to cpus, 0 or 1 (default: 1)"
+	},
+	{
+		.identifier = 'b',
+		.access_letters = "b",
+		.access_name = "assetCacheBudget",
+		.value_name = "VALUE",
+		.description = "Asset cache size in MiB, before the least recently used assets are evicted (default: 4096)"
+	},
+	{
+		.identifier = 'c',
+		.access_letters = "c",
+		.access_name = "assetCacheCompression",
+		.value_name = "VALUE",
+		.description = "Compress new asset cache blobs, 0 or 1 (default: 1)"
+	},
+	{
+		.identifier = 'v',
+		.access_letters = "v",
+		.access_name = "assetParanoidValidation",
+		.value_name = "VALUE",
+		.description = "Rehash every asset source and cache file on load, 0 or 1 (default: 0)"
+	},
 	{
 		.identifier = 'h',
 		.access_letters = "h?",
@@ -47,6 +89,8 @@ static struct cag_option gCmdArgs[] =
 static struct MouseEvent gMouse;
 static struct KeyboardEvent gKeyboard;
 static struct PathConfig gPaths;
+static struct TaskExecutorConfig gExecutorConfig;
+static struct AssetConfig gAssetConfig;
 static volatile bool gIsInterrupted = false;
 
 static void OnSignal(int signal)
@@ -418,6 +462,24 @@ int main(int argc, char* argv[], char* envp[])
 		case 'r':
 			gPaths.resourcePath = cag_option_get_value(&cagContext);
 			break;
+		case 't':
+			gExecutorConfig.topology = cag_option_get_value(&cagContext);
+			break;
+		case 'p':
+			gExecutorConfig.poolCapacity = (uint32_t)strtoul(cag_option_get_value(&cagContext), NULL, 10);
+			break;
+		case 'a':
+			gExecutorConfig.threadAffinity = atoi(cag_option_get_value(&cagContext)) != 0 ? kTaskThreadAffinityPinned : kTaskThreadAffinityNone;
+			break;
+		case 'b':
+			gAssetConfig.cacheBudget = (uint64_t)strtoull(cag_option_get_value(&cagContext), NULL, 10) << 20;
+			break;
+		case 'c':
+			gAssetConfig.cacheCompression = atoi(cag_option_get_value(&cagContext)) != 0 ? kAssetCacheCompressionOn : kAssetCacheCompressionOff;
+			break;
+		case 'v':
+			gAssetConfig.paranoidValidation = atoi(cag_option_get_value(&cagContext)) != 0;
+			break;
 		case 'h':
 			printf("Usage: client [OPTION]...\n");
 			cag_option_print(gCmdArgs, CAG_ARRAY_SIZE(gCmdArgs), stdout);
@@ -471,7 +533,7 @@ int main(int argc, char* argv[], char* envp[])
 	
 	glfwSetMonitorCallback(OnMonitorChanged);
 
-	ClientCreate(OnCreateWindow, &gPaths);
+	ClientCreate(OnCreateWindow, &gPaths, &gExecutorConfig, &gAssetConfig);
 	do { glfwWaitEvents(); }
 	while (!(bool)glfwWindowShouldClose((GLFWwindow*)GetCurrentWindow()) && ClientMain() && !gIsInterrupted);//NOLINT(performance-no-int-to-ptr)
 	ClientDestroy(OnDestroyWindow);
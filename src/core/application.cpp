@@ -2,16 +2,108 @@
 
 #include <core/assert.h>
 
+#include <limits>
+
 #if defined(SPEEDO_USE_MIMALLOC)
 #include <mimalloc-new-delete.h>
 #endif
 
 std::weak_ptr<Application> gApplication;
 
+namespace application
+{
+
+// "TaskPoolCapacity" (int64) is the initial size of the task pool.
+[[nodiscard]] static uint32_t GetTaskPoolCapacity(const Environment& env) noexcept
+{
+	if (auto it = env.variables.find("TaskPoolCapacity"); it != env.variables.end())
+		if (const auto* capacity = std::get_if<int64_t>(&it->second))
+			return static_cast<uint32_t>(std::clamp<int64_t>(*capacity, 1, kTaskPoolMaxSize));
+
+	return kTaskPoolDefaultCapacity;
+}
+
+// "TaskTopology" (string, see TaskExecutorTopology::Parse) overrides the system topology.
+// "TaskThreadAffinity" (bool) overrides whether worker threads are pinned to cpus.
+[[nodiscard]] static TaskExecutorTopology GetTaskExecutorTopology(const Environment& env)
+{
+	TaskExecutorTopology topology;
+
+	if (auto it = env.variables.find("TaskTopology"); it != env.variables.end())
+		if (const auto* spec = std::get_if<std::string>(&it->second))
+			topology = TaskExecutorTopology::Parse(*spec);
+
+	if (topology.nodes.empty())
+		topology = TaskExecutorTopology::FromSystem();
+
+	if (auto it = env.variables.find("TaskThreadAffinity"); it != env.variables.end())
+		if (const auto* pinThreads = std::get_if<bool>(&it->second))
+			topology.pinThreads = *pinThreads;
+
+	return topology;
+}
+
+// "AssetCacheBudget" (int64) is the size in bytes the asset cache is trimmed down to.
+[[nodiscard]] static std::unique_ptr<file::AssetCache> CreateAssetCache(const Environment& env, TaskExecutor& executor)
+{
+	auto pathIt = env.variables.find("UserProfilePath");
+	if (pathIt == env.variables.end())
+		return {};
+
+	const auto* userProfilePath = std::get_if<std::filesystem::path>(&pathIt->second);
+	if (userProfilePath == nullptr)
+		return {};
+
+	uint64_t budget = file::AssetCache::kDefaultByteBudget;
+	if (auto it = env.variables.find("AssetCacheBudget"); it != env.variables.end())
+		if (const auto* value = std::get_if<int64_t>(&it->second))
+			budget = static_cast<uint64_t>(std::max<int64_t>(*value, 0));
+
+	return std::make_unique<file::AssetCache>(*userProfilePath / "assetcache", budget, executor);
+}
+
+} // namespace application
+
+void AddEnvironmentVariables(Environment& env, const TaskExecutorConfig* config)
+{
+	if (config == nullptr)
+		return;
+
+	if (config->topology != nullptr)
+		env.variables["TaskTopology"] = std::string(config->topology);
+
+	if (config->poolCapacity != 0)
+		env.variables["TaskPoolCapacity"] = static_cast<int64_t>(config->poolCapacity);
+
+	if (config->threadAffinity != kTaskThreadAffinityDefault)
+		env.variables["TaskThreadAffinity"] = config->threadAffinity == kTaskThreadAffinityPinned;
+}
+
+void AddEnvironmentVariables(Environment& env, const AssetConfig* config)
+{
+	if (config == nullptr)
+		return;
+
+	if (config->cacheBudget != 0)
+		env.variables["AssetCacheBudget"] = static_cast<int64_t>(std::min<uint64_t>(config->cacheBudget, std::numeric_limits<int64_t>::max()));
+
+	if (config->cacheCompression != kAssetCacheCompressionDefault)
+		env.variables["AssetCacheCompression"] = config->cacheCompression == kAssetCacheCompressionOn;
+
+	if (config->paranoidValidation != 0)
+		env.variables["AssetParanoidValidation"] = true;
+}
+
 Application::Application(std::string_view name, Environment&& env)
 : myName(name)
 , myEnvironment(std::forward<Environment>(env))
-, myExecutor(std::make_unique<TaskExecutor>(std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 2)))
+, myExecutor(std::make_unique<TaskExecutor>(
+	std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 2),
+	application::GetTaskPoolCapacity(myEnvironment),
+	application::GetTaskExecutorTopology(myEnvironment)))
+, myAsyncReader(std::make_unique<file::AsyncReader>(*myExecutor))
+, myFileWatcher(std::make_unique<file::Watcher>())
+, myAssetCache(application::CreateAssetCache(myEnvironment, *myExecutor))
 {
 	ENSUREF(gApplication.use_count() == 0, "There can only be one application at a time");
 	std::set_terminate([]()
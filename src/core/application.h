@@ -1,6 +1,9 @@
 #pragma once
 
+#include "assetcache.h"
+#include "asyncreader.h"
 #include "capi.h"
+#include "filewatcher.h"
 #include "taskexecutor.h"
 #include "utils.h"
 
@@ -17,6 +20,10 @@ struct Environment
 	UnorderedMap<std::string, VariableValue> variables;
 };
 
+// sets the variables Application reads from its environment for the options in config, which may be nullptr
+void AddEnvironmentVariables(Environment& env, const TaskExecutorConfig* config);
+void AddEnvironmentVariables(Environment& env, const AssetConfig* config);
+
 class Application;
 extern std::weak_ptr<Application> gApplication;
 class Application
@@ -38,6 +45,12 @@ public:
 	[[nodiscard]] auto& GetExecutor() noexcept { return *myExecutor; }
 	[[nodiscard]] const auto& GetExecutor() const noexcept { return *myExecutor; }
 
+	[[nodiscard]] auto& GetAsyncReader() noexcept { return *myAsyncReader; }
+	[[nodiscard]] auto& GetFileWatcher() noexcept { return *myFileWatcher; }
+
+	// nullptr if the environment has no "UserProfilePath"
+	[[nodiscard]] file::AssetCache* GetAssetCache() noexcept { return myAssetCache.get(); }
+
 	void RequestExit() noexcept { myExitRequested = true; }
 	[[nodiscard]] bool IsExitRequested() const noexcept { return myExitRequested; }
 
@@ -49,5 +62,8 @@ private:
 	std::string myName;
 	Environment myEnvironment;
 	std::unique_ptr<TaskExecutor> myExecutor;
+	std::unique_ptr<file::AsyncReader> myAsyncReader;
+	std::unique_ptr<file::Watcher> myFileWatcher;
+	std::unique_ptr<file::AssetCache> myAssetCache; // after myExecutor, since it waits for its eviction task when destroyed
 	std::atomic_bool myExitRequested = false;
 };
@@ -0,0 +1,290 @@
+#include "assetcache.h"
+#include "file.h"
+#include "taskexecutor.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <stduuid/uuid.h>
+
+namespace file
+{
+
+AssetCache::AssetCache(std::filesystem::path directory, uint64_t byteBudget, TaskExecutor& executor)
+: myDirectory(std::move(directory))
+, myBudget(byteBudget)
+, myExecutor(executor)
+{
+	ZoneScopedN("AssetCache()");
+
+	std::error_code error;
+	std::filesystem::create_directories(myDirectory, error);
+	ENSUREF(!error, "Failed to create asset cache directory: {}", error.message());
+
+	InternalLoadIndex();
+
+	std::unique_lock lock(myMutex);
+	InternalScheduleEviction();
+}
+
+AssetCache::~AssetCache()
+{
+	ZoneScopedN("~AssetCache()");
+
+	Future<void> eviction;
+	{
+		std::unique_lock lock(myMutex);
+		eviction = std::move(myEviction);
+	}
+
+	if (eviction.Valid())
+		myExecutor.Join(std::move(eviction));
+
+	InternalSaveIndex();
+}
+
+std::string AssetCache::MakeKey(std::string_view sourceChecksum, std::string_view parameterHash)
+{
+	std::string keyData;
+	keyData.reserve(sourceChecksum.size() + parameterHash.size() + 1);
+	keyData.append(sourceChecksum);
+	keyData.push_back('\0');
+	keyData.append(parameterHash);
+
+	return detail::GetChecksum(
+		std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(keyData.data()), keyData.size()),
+		ChecksumMode::kXxh3128);
+}
+
+std::filesystem::path AssetCache::GetPath(std::string_view key) const
+{
+	return myDirectory / key;
+}
+
+std::filesystem::path AssetCache::GetStagingPath(std::string_view key) const
+{
+	auto path = GetPath(key);
+	path += '.';
+	path += uuids::to_string(uuids::uuid_system_generator{}());
+	path += kStagingExtension;
+
+	return path;
+}
+
+bool AssetCache::Touch(std::string_view key)
+{
+	std::unique_lock lock(myMutex);
+
+	auto it = myEntries.find(std::string(key));
+	if (it == myEntries.end())
+		return false;
+
+	it->second.lastAccess = InternalNow();
+
+	return true;
+}
+
+bool AssetCache::Pin(std::string_view key)
+{
+	std::unique_lock lock(myMutex);
+
+	auto it = myEntries.find(std::string(key));
+	if (it == myEntries.end())
+		return false;
+
+	it->second.lastAccess = InternalNow();
+	it->second.pins++;
+
+	return true;
+}
+
+void AssetCache::Unpin(std::string_view key)
+{
+	std::unique_lock lock(myMutex);
+
+	auto it = myEntries.find(std::string(key));
+	ENSURE(it != myEntries.end() && it->second.pins > 0);
+
+	// evictions that ran while the blob was pinned may have left the store over budget
+	if (--it->second.pins == 0)
+		InternalScheduleEviction();
+}
+
+std::expected<std::filesystem::path, std::error_code>
+AssetCache::Insert(std::string_view key, const std::filesystem::path& stagingPath)
+{
+	ZoneScoped;
+
+	std::error_code error;
+
+	auto size = std::filesystem::file_size(stagingPath, error);
+	if (error)
+		return std::unexpected(error);
+
+	auto path = GetPath(key);
+
+	std::unique_lock lock(myMutex);
+
+	// rename replaces any blob published by a concurrent import of the same key, which has identical contents
+	std::filesystem::rename(stagingPath, path, error);
+	if (error)
+		return std::unexpected(error);
+
+	auto [it, inserted] = myEntries.emplace(std::string(key), Entry{});
+	if (!inserted)
+		mySize -= it->second.size;
+
+	it->second = Entry{.size = size, .lastAccess = InternalNow(), .pins = it->second.pins + 1};
+	mySize += size;
+
+	InternalScheduleEviction();
+
+	return path;
+}
+
+void AssetCache::Evict()
+{
+	ZoneScoped;
+
+	{
+		std::unique_lock lock(myMutex);
+
+		if (mySize <= myBudget || myEntries.size() < 2)
+			return;
+
+		std::vector<std::pair<int64_t, std::string>> entries;
+		entries.reserve(myEntries.size());
+		for (const auto& [key, entry] : myEntries)
+			entries.emplace_back(entry.lastAccess, key);
+
+		std::ranges::sort(entries);
+
+		// the most recently used blob is always kept, it is likely about to be loaded
+		for (auto entryIt = entries.begin(); entryIt != std::prev(entries.end()) && mySize > myBudget; entryIt++)
+		{
+			auto it = myEntries.find(entryIt->second);
+			if (it->second.pins > 0)
+				continue;
+
+			// files are removed while holding the lock, so a concurrent Insert of the same key can not lose its blob
+			std::error_code error;
+			std::filesystem::remove(GetPath(entryIt->second), error);
+			if (error)
+			{
+				std::cerr << "Failed to evict asset cache blob: " << error.message() << ", Path: " << GetPath(entryIt->second) << '\n';
+				continue;
+			}
+
+			mySize -= it->second.size;
+			myEntries.erase(it);
+		}
+	}
+
+	InternalSaveIndex();
+}
+
+uint64_t AssetCache::Size() const
+{
+	std::unique_lock lock(myMutex);
+
+	return mySize;
+}
+
+int64_t AssetCache::InternalNow() noexcept
+{
+	return std::filesystem::file_time_type::clock::now().time_since_epoch().count();
+}
+
+void AssetCache::InternalLoadIndex()
+{
+	ZoneScoped;
+
+	UnorderedMap<std::string, int64_t> lastAccess;
+	if (auto index = LoadObject<std::vector<IndexEntry>>(myDirectory / kIndexFileName); index)
+		for (auto& entry : *index)
+			lastAccess.emplace(std::move(entry.key), entry.lastAccess);
+
+	// the directory is the source of truth, the index only remembers access times. blobs that were written after the
+	// index was last saved (e.g. if the process was killed) fall back on their last write time, and stale index entries are dropped.
+	std::unique_lock lock(myMutex);
+
+	std::error_code error;
+	for (const auto& directoryEntry : std::filesystem::directory_iterator(myDirectory, error))
+	{
+		const auto& path = directoryEntry.path();
+		std::error_code entryError;
+
+		if (!directoryEntry.is_regular_file(entryError) || path.filename() == kIndexFileName)
+			continue;
+
+		// left behind by an interrupted import
+		if (path.extension() == kStagingExtension)
+		{
+			std::filesystem::remove(path, entryError);
+			continue;
+		}
+
+		auto size = directoryEntry.file_size(entryError);
+		if (entryError)
+			continue;
+
+		auto key = path.filename().string();
+		auto it = lastAccess.find(key);
+		auto access = it != lastAccess.end() ? it->second : directoryEntry.last_write_time(entryError).time_since_epoch().count();
+
+		myEntries.emplace(std::move(key), Entry{.size = size, .lastAccess = access});
+		mySize += size;
+	}
+
+	if (error)
+		std::cerr << "Failed to scan asset cache directory: " << error.message() << ", Path: " << myDirectory << '\n';
+}
+
+void AssetCache::InternalSaveIndex()
+{
+	ZoneScoped;
+
+	std::vector<IndexEntry> index;
+	{
+		std::unique_lock lock(myMutex);
+
+		index.reserve(myEntries.size());
+		for (const auto& [key, entry] : myEntries)
+			index.emplace_back(IndexEntry{.key = key, .size = entry.size, .lastAccess = entry.lastAccess});
+	}
+
+	std::unique_lock lock(myIndexMutex);
+
+	// write + rename, so that a torn write never leaves a corrupt index behind
+	auto indexPath = myDirectory / kIndexFileName;
+	auto stagingPath = indexPath;
+	stagingPath += kStagingExtension;
+
+	if (auto result = SaveObject(index, stagingPath.string()); !result)
+	{
+		std::cerr << "Failed to save asset cache index: " << result.error().message() << '\n';
+		return;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(stagingPath, indexPath, error);
+	if (error)
+	{
+		std::cerr << "Failed to save asset cache index: " << error.message() << '\n';
+	}
+}
+
+void AssetCache::InternalScheduleEviction()
+{
+	if (mySize <= myBudget || (myEviction.Valid() && !myEviction.IsReady()))
+		return;
+
+	auto [task, future] = CreateTask([this] { Evict(); });
+	SetPriority(task, kTaskPriorityBackground);
+
+	myEviction = std::move(future);
+	myExecutor.Submit({&task, 1});
+}
+
+} // namespace file
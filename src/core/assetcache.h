@@ -0,0 +1,91 @@
+#pragma once
+
+#include "task.h"
+#include "utils.h"
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+class TaskExecutor;
+
+namespace file
+{
+
+// content addressed store for imported asset blobs. blobs are keyed by a hash of the source files checksum and the import parameters,
+// so identical inputs share a single blob wherever the source lives. a persistent index keeps the size and last access time of every blob,
+// and whenever the store grows past its byte budget the least recently used blobs are evicted in the background on the executor.
+class AssetCache
+{
+public:
+	static constexpr uint64_t kDefaultByteBudget = 4ULL << 30;
+
+	AssetCache(std::filesystem::path directory, uint64_t byteBudget, TaskExecutor& executor);
+	AssetCache(const AssetCache&) = delete;
+	AssetCache(AssetCache&&) noexcept = delete;
+	~AssetCache(); // waits for any eviction in flight, then saves the index
+
+	AssetCache& operator=(const AssetCache&) = delete;
+	AssetCache& operator=(AssetCache&&) noexcept = delete;
+
+	[[nodiscard]] static std::string MakeKey(std::string_view sourceChecksum, std::string_view parameterHash);
+
+	[[nodiscard]] const auto& GetDirectory() const noexcept { return myDirectory; }
+	[[nodiscard]] std::filesystem::path GetPath(std::string_view key) const;
+	// unique path to write a new blob to, before publishing it with Insert
+	[[nodiscard]] std::filesystem::path GetStagingPath(std::string_view key) const;
+
+	// returns false if there is no blob for key, otherwise marks it as most recently used
+	[[nodiscard]] bool Touch(std::string_view key);
+	// like Touch, but also keeps the blob from being evicted until it is unpinned, e.g. between validating and reading it
+	[[nodiscard]] bool Pin(std::string_view key);
+	void Unpin(std::string_view key);
+
+	// atomically moves a blob from stagingPath into the store, and pins it. a blob already published under key (by a concurrent import
+	// of the same inputs, so with identical contents) is replaced, while anyone that has the old one open or mapped keeps reading it.
+	[[nodiscard]] std::expected<std::filesystem::path, std::error_code> Insert(std::string_view key, const std::filesystem::path& stagingPath);
+
+	// blocking. removes least recently used blobs that are not pinned until the store is within budget, and saves the index.
+	void Evict();
+
+	[[nodiscard]] uint64_t Size() const;
+	[[nodiscard]] uint64_t Budget() const noexcept { return myBudget; }
+
+private:
+	struct Entry
+	{
+		uint64_t size = 0;
+		int64_t lastAccess = 0; // std::filesystem::file_time_type ticks
+		uint32_t pins = 0;
+	};
+
+	struct IndexEntry
+	{
+		std::string key;
+		uint64_t size = 0;
+		int64_t lastAccess = 0;
+	};
+
+	static constexpr std::string_view kIndexFileName = "index.bin";
+	static constexpr std::string_view kStagingExtension = ".staging";
+
+	[[nodiscard]] static int64_t InternalNow() noexcept;
+	void InternalLoadIndex();
+	void InternalSaveIndex();
+	void InternalScheduleEviction(); // myMutex needs to be locked
+
+	std::filesystem::path myDirectory;
+	uint64_t myBudget = 0;
+	TaskExecutor& myExecutor;
+	mutable std::mutex myMutex;
+	UnorderedMap<std::string, Entry> myEntries; // protected by myMutex
+	uint64_t mySize = 0; // protected by myMutex
+	Future<void> myEviction; // protected by myMutex
+	std::mutex myIndexMutex; // serializes index writes
+};
+
+} // namespace file
@@ -0,0 +1,528 @@
+#include "asyncreader.h"
+#include "assert.h"//NOLINT(modernize-deprecated-headers)
+#include "profiling.h"
+#include "taskexecutor.h"
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#	include <fcntl.h>
+#	include <sys/uio.h>
+#	include <unistd.h>
+#	if defined(__linux__)
+#		include <linux/io_uring.h>
+#		include <sys/mman.h>
+#		include <sys/syscall.h>
+#	endif
+#endif
+
+namespace file
+{
+
+struct AsyncReader::Request
+{
+	std::filesystem::path path;
+	uint64_t offset = 0;
+	bool write = false;
+	std::vector<std::span<std::byte>> buffers;
+#if defined(__linux__)
+	std::vector<iovec> iovecs;
+	std::span<iovec> remaining; // what is left of iovecs after short transfers
+	std::size_t transferred = 0;
+	int fd = -1;
+#endif
+	Result result;
+	TaskHandle completion;
+};
+
+namespace asyncreader
+{
+
+#if !defined(_WIN32)
+// drops the first bytes of iovecs, which have been transferred
+[[nodiscard]] static std::span<iovec> Consume(std::span<iovec> iovecs, std::size_t bytes) noexcept
+{
+	while (bytes > 0 && !iovecs.empty())
+	{
+		auto& front = iovecs.front();
+		if (bytes < front.iov_len)
+		{
+			front.iov_base = static_cast<std::byte*>(front.iov_base) + bytes;
+			front.iov_len -= bytes;
+			break;
+		}
+
+		bytes -= front.iov_len;
+		iovecs = iovecs.subspan(1);
+	}
+
+	return iovecs;
+}
+#endif
+
+[[nodiscard]] static AsyncReader::Result BlockingTransfer(const std::filesystem::path& path, uint64_t offset, bool write, std::span<const std::span<std::byte>> buffers)
+{
+	ZoneScopedN("AsyncReader::BlockingTransfer");
+
+	std::size_t transferred = 0;
+
+#if defined(_WIN32)
+	if (write && !std::filesystem::exists(path))
+		std::ofstream(path, std::ios::binary);
+
+	std::fstream file(path, std::ios::binary | std::ios::in | (write ? std::ios::out : std::ios::openmode{}));
+	if (!file)
+		return std::unexpected(std::make_error_code(std::errc::no_such_file_or_directory));
+
+	if (write)
+		file.seekp(static_cast<std::streamoff>(offset));
+	else
+		file.seekg(static_cast<std::streamoff>(offset));
+
+	for (auto buffer : buffers)
+	{
+		if (write)
+		{
+			if (!file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())))
+				return std::unexpected(std::make_error_code(std::errc::io_error));
+
+			transferred += buffer.size();
+		}
+		else
+		{
+			file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+			transferred += static_cast<std::size_t>(file.gcount());
+
+			if (file.eof())
+				break;
+
+			if (!file)
+				return std::unexpected(std::make_error_code(std::errc::io_error));
+		}
+	}
+#else
+	int fd = ::open(path.c_str(), write ? (O_WRONLY | O_CREAT | O_CLOEXEC) : (O_RDONLY | O_CLOEXEC), 0644);
+	if (fd < 0)
+		return std::unexpected(std::error_code(errno, std::system_category()));
+
+	std::vector<iovec> iovecs;
+	iovecs.reserve(buffers.size());
+	for (auto buffer : buffers)
+		iovecs.push_back({buffer.data(), buffer.size()});
+
+	// short transfers resume where they left off, until everything is done or a read hits the end of the file
+	auto remaining = std::span(iovecs);
+	while (!remaining.empty())
+	{
+		auto count = static_cast<int>(std::min<std::size_t>(remaining.size(), IOV_MAX));
+		auto position = static_cast<off_t>(offset + transferred);
+		auto result = write ? ::pwritev(fd, remaining.data(), count, position) : ::preadv(fd, remaining.data(), count, position);
+
+		if (result < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			auto error = std::error_code(errno, std::system_category());
+			::close(fd);
+			return std::unexpected(error);
+		}
+
+		if (result == 0)
+			break;
+
+		transferred += static_cast<std::size_t>(result);
+		remaining = Consume(remaining, static_cast<std::size_t>(result));
+	}
+
+	::close(fd);
+#endif
+
+	return transferred;
+}
+
+} // namespace asyncreader
+
+#if defined(__linux__)
+
+// raw io_uring setup, instead of pulling in liburing for the handful of operations used here
+struct AsyncReader::Ring
+{
+	explicit Ring(uint32_t entries)
+	{
+		io_uring_params params{};
+		fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+		if (fd < 0)
+			return;
+
+		sqSize = params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+		cqSize = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+		sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+		bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (singleMap)
+			sqSize = cqSize = std::max(sqSize, cqSize);
+
+		sqMemory = ::mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		cqMemory = singleMap ? sqMemory : ::mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+
+		if (sqMemory == MAP_FAILED || cqMemory == MAP_FAILED || sqes == MAP_FAILED)
+		{
+			Destroy();
+			return;
+		}
+
+		auto* sq = static_cast<std::byte*>(sqMemory);
+		sqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+		sqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+		sqMask = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+		sqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+		sqEntries = params.sq_entries;
+
+		auto* cq = static_cast<std::byte*>(cqMemory);
+		cqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+		cqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+		cqMask = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+		cqEntries = params.cq_entries;
+	}
+
+	~Ring() { Destroy(); }
+
+	[[nodiscard]] bool Valid() const noexcept { return fd >= 0; }
+
+	void Destroy() noexcept
+	{
+		if (sqes != nullptr && sqes != MAP_FAILED)
+			::munmap(sqes, sqesSize);
+		if (cqMemory != nullptr && cqMemory != MAP_FAILED && cqMemory != sqMemory)
+			::munmap(cqMemory, cqSize);
+		if (sqMemory != nullptr && sqMemory != MAP_FAILED)
+			::munmap(sqMemory, sqSize);
+		if (fd >= 0)
+			::close(fd);
+
+		sqes = nullptr;
+		cqMemory = sqMemory = nullptr;
+		fd = -1;
+	}
+
+	[[nodiscard]] int Enter(uint32_t toSubmit, uint32_t minComplete, uint32_t flags) const noexcept
+	{
+		auto result = static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+
+		return result < 0 ? -errno : result;
+	}
+
+	// needs submitMutex to be locked. queues the sqe, which is handed to the kernel by the next Submit.
+	void Push(const io_uring_sqe& sqe)
+	{
+		auto tail = *sqTail;
+
+		// every slot holds an entry the kernel has not consumed yet
+		while (tail - std::atomic_ref(*sqHead).load(std::memory_order_acquire) == sqEntries)
+			Submit();
+
+		auto index = tail & sqMask;
+
+		sqes[index] = sqe;
+		sqArray[index] = index;
+
+		std::atomic_ref(*sqTail).store(tail + 1, std::memory_order_release);
+
+		queued.fetch_add(1);
+	}
+
+	// hands everything queued to the kernel in a single call. concurrent callers combine: while one of them is submitting,
+	// the others return right away, and whatever they queued goes in with its next round.
+	void Submit()
+	{
+		while (queued.load() != 0 && !submitting.exchange(true))
+		{
+			queued.exchange(0);
+
+			// the kernel takes up to as many entries as there are in the queue
+			for (auto tail = std::atomic_ref(*sqTail).load(std::memory_order_acquire);
+				 static_cast<int32_t>(tail - std::atomic_ref(*sqHead).load(std::memory_order_acquire)) > 0;)
+			{
+				auto result = Enter(sqEntries, 0, 0);
+				if (result != -EINTR && result != -EAGAIN && result != -EBUSY)
+					ENSUREF(result >= 0, "io_uring_enter failed: {}", std::error_code(-result, std::system_category()).message());
+			}
+
+			submitting.store(false);
+		}
+	}
+
+	int fd = -1;
+
+	void* sqMemory = nullptr;
+	std::size_t sqSize = 0;
+	uint32_t* sqHead = nullptr;
+	uint32_t* sqTail = nullptr;
+	uint32_t sqMask = 0;
+	uint32_t* sqArray = nullptr;
+	uint32_t sqEntries = 0;
+	io_uring_sqe* sqes = nullptr;
+	std::size_t sqesSize = 0;
+
+	void* cqMemory = nullptr;
+	std::size_t cqSize = 0;
+	uint32_t* cqHead = nullptr;
+	uint32_t* cqTail = nullptr;
+	uint32_t cqMask = 0;
+	io_uring_cqe* cqes = nullptr;
+	uint32_t cqEntries = 0;
+
+	std::mutex submitMutex;
+	std::atomic_uint32_t queued = 0; // pushed since the last Submit started
+	std::atomic_bool submitting = false;
+	std::thread completionThread;
+};
+
+#else
+
+struct AsyncReader::Ring
+{};
+
+#endif
+
+AsyncReader::AsyncReader(TaskExecutor& executor, uint32_t queueDepth)
+: myExecutor(executor)
+{
+	ZoneScopedN("AsyncReader()");
+
+#if defined(__linux__)
+	auto ring = std::make_unique<Ring>(std::max(queueDepth, 1U));
+	if (ring->Valid())
+	{
+		myRing = std::move(ring);
+		myRing->completionThread = std::thread(&AsyncReader::InternalReap, this);
+	}
+#else
+	(void)queueDepth;
+#endif
+}
+
+AsyncReader::~AsyncReader()
+{
+	ZoneScopedN("~AsyncReader()");
+
+	for (auto inFlight = myInFlight.load(std::memory_order_acquire); inFlight != 0; inFlight = myInFlight.load(std::memory_order_acquire))
+		myInFlight.wait(inFlight, std::memory_order_acquire);
+
+#if defined(__linux__)
+	if (!myRing)
+		return;
+
+	// a nop without user data tells the completion thread to exit
+	{
+		std::unique_lock lock(myRing->submitMutex);
+		io_uring_sqe sqe{};
+		sqe.opcode = IORING_OP_NOP;
+		myRing->Push(sqe);
+	}
+	myRing->Submit();
+
+	myRing->completionThread.join();
+#endif
+}
+
+Future<AsyncReader::Result> AsyncReader::Read(const std::filesystem::path& filePath, uint64_t offset, std::span<const std::span<std::byte>> buffers)
+{
+	auto request = std::make_unique<Request>();
+	request->path = filePath;
+	request->offset = offset;
+	request->buffers.assign(buffers.begin(), buffers.end());
+
+	return InternalEnqueue(std::move(request));
+}
+
+Future<AsyncReader::Result> AsyncReader::Write(const std::filesystem::path& filePath, uint64_t offset, std::span<const std::span<const std::byte>> buffers)
+{
+	auto request = std::make_unique<Request>();
+	request->path = filePath;
+	request->offset = offset;
+	request->write = true;
+	request->buffers.reserve(buffers.size());
+	for (auto buffer : buffers)
+		request->buffers.emplace_back(const_cast<std::byte*>(buffer.data()), buffer.size()); //NOLINT(cppcoreguidelines-pro-type-const-cast)
+
+	return InternalEnqueue(std::move(request));
+}
+
+Future<AsyncReader::Result> AsyncReader::InternalEnqueue(std::unique_ptr<Request>&& request)
+{
+	ZoneScopedN("AsyncReader::InternalEnqueue");
+
+	// the completion task hands the result over to the future, and owns the request from then on
+	auto [completion, future] = CreateTask([request = request.get()]() -> Result
+	{
+		std::unique_ptr<Request> owned(request);
+		return owned->result;
+	});
+
+	if (!myRing)
+	{
+		auto [transfer, transferFuture] = CreateTask([this, request = request.release()]
+		{
+			request->result = asyncreader::BlockingTransfer(request->path, request->offset, request->write, request->buffers);
+
+			myInFlight.fetch_sub(1, std::memory_order_acq_rel);
+			myInFlight.notify_all();
+		});
+		SetPriority(transfer, kTaskPriorityBackground);
+		AddDependency(transfer, completion);
+
+		myInFlight.fetch_add(1, std::memory_order_relaxed);
+		myExecutor.Submit({&transfer, 1});
+
+		return future;
+	}
+
+#if defined(__linux__)
+	request->completion = completion;
+
+	request->fd = ::open(request->path.c_str(), request->write ? (O_WRONLY | O_CREAT | O_CLOEXEC) : (O_RDONLY | O_CLOEXEC), 0644);
+	if (request->fd < 0)
+	{
+		InternalComplete(request.release(), std::unexpected(std::error_code(errno, std::system_category())));
+		return future;
+	}
+
+	request->iovecs.reserve(request->buffers.size());
+	for (auto buffer : request->buffers)
+		request->iovecs.push_back({buffer.data(), buffer.size()});
+
+	request->remaining = request->iovecs;
+
+	// never more requests in flight than the completion queue can hold
+	for (;;)
+	{
+		auto inFlight = myInFlight.load(std::memory_order_relaxed);
+		if (inFlight >= myRing->cqEntries)
+		{
+			myInFlight.wait(inFlight, std::memory_order_relaxed);
+			continue;
+		}
+
+		if (myInFlight.compare_exchange_weak(inFlight, inFlight + 1, std::memory_order_acq_rel))
+			break;
+	}
+
+	InternalSubmit(request.release());
+#endif
+
+	return future;
+}
+
+void AsyncReader::InternalSubmit(Request* request)
+{
+#if defined(__linux__)
+	// a single sqe takes at most IOV_MAX buffers, like preadv. the rest goes in when the first part completes.
+	io_uring_sqe sqe{};
+	sqe.opcode = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+	sqe.fd = request->fd;
+	sqe.off = request->offset + request->transferred;
+	sqe.addr = reinterpret_cast<uint64_t>(request->remaining.data());
+	sqe.len = static_cast<uint32_t>(std::min<std::size_t>(request->remaining.size(), IOV_MAX));
+	sqe.user_data = reinterpret_cast<uint64_t>(request);
+
+	{
+		std::unique_lock lock(myRing->submitMutex);
+		myRing->Push(sqe);
+	}
+	myRing->Submit();
+#else
+	(void)request;
+#endif
+}
+
+void AsyncReader::InternalComplete(Request* request, Result result)
+{
+#if defined(__linux__)
+	if (request->fd >= 0)
+		::close(request->fd);
+#endif
+
+	request->result = std::move(result);
+
+	auto completion = request->completion;
+	myExecutor.Submit({&completion, 1});
+}
+
+void AsyncReader::InternalReap()
+{
+#if defined(__linux__)
+	ZoneScopedN("AsyncReader::InternalReap");
+
+	auto& ring = *myRing;
+
+	for (bool exit = false; !exit;)
+	{
+		if (auto result = ring.Enter(0, 1, IORING_ENTER_GETEVENTS); result < 0 && result != -EINTR)
+		{
+			ENSUREF(false, "io_uring_enter failed: {}", std::error_code(-result, std::system_category()).message());
+		}
+
+		auto head = *ring.cqHead;
+		auto tail = std::atomic_ref(*ring.cqTail).load(std::memory_order_acquire);
+		uint32_t completed = 0;
+
+		for (; head != tail; head++)
+		{
+			const auto& cqe = ring.cqes[head & ring.cqMask];
+
+			if (cqe.user_data == 0)
+			{
+				exit = true;
+				continue;
+			}
+
+			auto* request = reinterpret_cast<Request*>(cqe.user_data);
+
+			if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+			{
+				InternalSubmit(request);
+				continue;
+			}
+
+			if (cqe.res < 0)
+			{
+				InternalComplete(request, std::unexpected(std::error_code(-cqe.res, std::system_category())));
+				completed++;
+				continue;
+			}
+
+			// short transfers resume where they left off, until everything is done or a read hits the end of the file
+			auto bytes = static_cast<std::size_t>(cqe.res);
+			request->transferred += bytes;
+			request->remaining = asyncreader::Consume(request->remaining, bytes);
+
+			if (bytes != 0 && !request->remaining.empty())
+			{
+				InternalSubmit(request);
+				continue;
+			}
+
+			InternalComplete(request, request->transferred);
+			completed++;
+		}
+
+		std::atomic_ref(*ring.cqHead).store(head, std::memory_order_release);
+
+		if (completed != 0)
+		{
+			myInFlight.fetch_sub(completed, std::memory_order_acq_rel);
+			myInFlight.notify_all();
+		}
+	}
+#endif
+}
+
+} // namespace file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "task.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <system_error>
+
+class TaskExecutor;
+
+namespace file
+{
+
+// asynchronous scatter/gather file io. on linux, requests are batched through an io_uring that is drained by a completion thread.
+// elsewhere, or where io_uring is unavailable (old kernels, seccomp), each request runs as blocking preadv/pwritev in a background task.
+// either way the returned future becomes ready on the executor, holding the number of bytes transferred.
+// like preadv, a read can return less than requested at the end of the file. the buffers need to stay alive until the future is ready.
+class AsyncReader
+{
+public:
+	using Result = std::expected<std::size_t, std::error_code>;
+
+	static constexpr uint32_t kDefaultQueueDepth = 64;
+
+	explicit AsyncReader(TaskExecutor& executor, uint32_t queueDepth = kDefaultQueueDepth);
+	AsyncReader(const AsyncReader&) = delete;
+	AsyncReader(AsyncReader&&) noexcept = delete;
+	~AsyncReader(); // waits for all requests in flight
+
+	AsyncReader& operator=(const AsyncReader&) = delete;
+	AsyncReader& operator=(AsyncReader&&) noexcept = delete;
+
+	// reads consecutive bytes of filePath, starting at offset, into buffers
+	[[nodiscard]] Future<Result> Read(const std::filesystem::path& filePath, uint64_t offset, std::span<const std::span<std::byte>> buffers);
+
+	// writes buffers to consecutive bytes of filePath, starting at offset. the file is created if it does not exist.
+	[[nodiscard]] Future<Result> Write(const std::filesystem::path& filePath, uint64_t offset, std::span<const std::span<const std::byte>> buffers);
+
+	[[nodiscard]] bool UsesIoUring() const noexcept { return myRing != nullptr; }
+
+private:
+	struct Ring;
+	struct Request;
+
+	[[nodiscard]] Future<Result> InternalEnqueue(std::unique_ptr<Request>&& request);
+	void InternalSubmit(Request* request); // io_uring only. (re)submits what is left of the request
+	void InternalComplete(Request* request, Result result);
+	void InternalReap(); // completion thread
+
+	TaskExecutor& myExecutor;
+	std::unique_ptr<Ring> myRing; // nullptr when falling back on blocking io
+	std::atomic_uint32_t myInFlight = 0; // requests submitted to the ring (or blocking transfers submitted to the executor), but not completed yet
+};
+
+} // namespace file
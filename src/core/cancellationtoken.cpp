@@ -0,0 +1,93 @@
+#include "cancellationtoken.h"
+#include "assert.h"//NOLINT(modernize-deprecated-headers)
+
+#include <utility>
+
+CancellationToken::CancellationToken(const CancellationToken& other) noexcept
+	: myState(other.myState)
+{
+	if (myState != nullptr)
+		myState->refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+CancellationToken::CancellationToken(CancellationToken&& other) noexcept
+	: myState(std::exchange(other.myState, nullptr))
+{}
+
+CancellationToken::~CancellationToken() noexcept
+{
+	InternalRelease();
+}
+
+CancellationToken& CancellationToken::operator=(const CancellationToken& other) noexcept
+{
+	if (this != &other)
+	{
+		if (other.myState != nullptr)
+			other.myState->refCount.fetch_add(1, std::memory_order_relaxed);
+
+		InternalRelease();
+
+		myState = other.myState;
+	}
+
+	return *this;
+}
+
+CancellationToken& CancellationToken::operator=(CancellationToken&& other) noexcept
+{
+	if (this != &other)
+	{
+		InternalRelease();
+
+		myState = std::exchange(other.myState, nullptr);
+	}
+
+	return *this;
+}
+
+CancellationToken CancellationToken::Create()
+{
+	CancellationToken token;
+	token.myState = new State();
+
+	return token;
+}
+
+void CancellationToken::Cancel() noexcept
+{
+	ENSUREF(myState != nullptr, "CancellationToken has no state!");
+
+	myState->cancelled.store(true, std::memory_order_release);
+}
+
+void CancellationToken::SetDeadline(Clock::time_point deadline) noexcept
+{
+	ENSUREF(myState != nullptr, "CancellationToken has no state!");
+
+	myState->deadline.store(deadline.time_since_epoch().count(), std::memory_order_release);
+}
+
+bool CancellationToken::IsCancellationRequested() const noexcept
+{
+	if (myState == nullptr)
+		return false;
+
+	if (myState->cancelled.load(std::memory_order_acquire))
+		return true;
+
+	auto deadline = myState->deadline.load(std::memory_order_acquire);
+
+	return deadline != Clock::time_point::max().time_since_epoch().count() && Clock::now().time_since_epoch().count() >= deadline;
+}
+
+void CancellationToken::InternalRelease() noexcept
+{
+	if (myState == nullptr)
+		return;
+
+	if (myState->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		delete myState;
+
+	myState = nullptr;
+}
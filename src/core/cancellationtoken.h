@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// cooperative cancellation flag + optional deadline, shared by all copies of a token.
+// tasks holding a cancelled token (see SetCancellationToken) are dropped by the executor instead of being run, and so are the tasks depending on them.
+// long running tasks can poll IsCancellationRequested to stop early. a default constructed token has no state and is never cancelled.
+class CancellationToken
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	constexpr CancellationToken() noexcept = default;
+	CancellationToken(const CancellationToken& other) noexcept;
+	CancellationToken(CancellationToken&& other) noexcept;
+	~CancellationToken() noexcept;
+
+	[[maybe_unused]] CancellationToken& operator=(const CancellationToken& other) noexcept;
+	[[maybe_unused]] CancellationToken& operator=(CancellationToken&& other) noexcept;
+
+	[[nodiscard]] static CancellationToken Create();
+
+	[[nodiscard]] explicit operator bool() const noexcept { return myState != nullptr; }
+
+	void Cancel() noexcept;
+	void SetDeadline(Clock::time_point deadline) noexcept; // the token counts as cancelled once deadline has passed
+
+	[[nodiscard]] bool IsCancellationRequested() const noexcept;
+
+private:
+	struct State
+	{
+		std::atomic<uint32_t> refCount{1U};
+		std::atomic<bool> cancelled{false};
+		std::atomic<Clock::rep> deadline{Clock::time_point::max().time_since_epoch().count()};
+	};
+
+	void InternalRelease() noexcept;
+
+	State* myState = nullptr;
+};
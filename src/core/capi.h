@@ -24,6 +24,34 @@ struct PathConfig
 	const char* resourcePath;
 };
 
+enum TaskThreadAffinity
+{
+	kTaskThreadAffinityDefault = 0, // whatever the topology asks for: pinned on linux, and for topologies given as a cpu list
+	kTaskThreadAffinityPinned = 1,
+	kTaskThreadAffinityNone = 2
+};
+
+struct TaskExecutorConfig
+{
+	const char* topology; // NUMA nodes with cpu lists, e.g. "0-7,16-23;8-15,24-31". NULL reads the topology from the system.
+	uint32_t poolCapacity; // tasks in flight before the task pool grows. 0 uses the default.
+	uint8_t threadAffinity; // enum TaskThreadAffinity
+};
+
+enum AssetCacheCompression
+{
+	kAssetCacheCompressionDefault = 0, // compressed
+	kAssetCacheCompressionOn = 1,
+	kAssetCacheCompressionOff = 2
+};
+
+struct AssetConfig
+{
+	uint64_t cacheBudget; // bytes the asset cache is trimmed down to. 0 uses the default.
+	uint8_t cacheCompression; // enum AssetCacheCompression, for blobs written from now on
+	uint8_t paranoidValidation; // nonzero rehashes every source and cache file on load, instead of trusting unchanged sizes and times
+};
+
 struct MouseEvent
 {
 	enum : uint8_t
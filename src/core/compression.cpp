@@ -0,0 +1,255 @@
+#include "compression.h"
+#include "profiling.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace compression
+{
+
+namespace detail
+{
+
+static constexpr std::size_t kMinMatch = 4;
+static constexpr std::size_t kLastLiterals = 5; // the format requires the last bytes of a block to be literals
+static constexpr std::size_t kMatchSafeDistance = 12; // and the last match to start at least this far from the end
+static constexpr std::size_t kMaxOffset = 65535;
+static constexpr std::size_t kRunMask = 15;
+static constexpr uint32_t kHashLog = 12;
+
+static uint32_t Load32(const uint8_t* ptr) noexcept
+{
+	uint32_t value;
+	std::memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+static uint32_t Hash(uint32_t sequence) noexcept
+{
+	return (sequence * 2654435761U) >> (32 - kHashLog);
+}
+
+class Writer
+{
+public:
+	Writer(uint8_t* begin, uint8_t* end) noexcept : myPtr(begin), myEnd(end) {}
+
+	[[nodiscard]] bool Byte(uint8_t value) noexcept
+	{
+		if (myPtr == myEnd)
+			return false;
+
+		*myPtr++ = value;
+		return true;
+	}
+
+	[[nodiscard]] bool Length(std::size_t length) noexcept // the part of a length that did not fit in the token
+	{
+		for (; length >= 255; length -= 255)
+			if (!Byte(255))
+				return false;
+
+		return Byte(static_cast<uint8_t>(length));
+	}
+
+	[[nodiscard]] bool Bytes(const uint8_t* data, std::size_t size) noexcept
+	{
+		if (static_cast<std::size_t>(myEnd - myPtr) < size)
+			return false;
+
+		if (size != 0)
+			std::memcpy(myPtr, data, size);
+
+		myPtr += size;
+		return true;
+	}
+
+	[[nodiscard]] uint8_t* Ptr() const noexcept { return myPtr; }
+
+private:
+	uint8_t* myPtr;
+	uint8_t* myEnd;
+};
+
+// literals, followed by a match unless this is the last sequence of the block
+static bool WriteSequence(Writer& out, const uint8_t* literals, std::size_t literalLength, std::size_t offset, std::size_t matchLength) noexcept
+{
+	auto matchCode = matchLength != 0 ? matchLength - kMinMatch : 0;
+	auto token = static_cast<uint8_t>((std::min(literalLength, kRunMask) << 4) | std::min(matchCode, kRunMask));
+
+	if (!out.Byte(token))
+		return false;
+
+	if (literalLength >= kRunMask && !out.Length(literalLength - kRunMask))
+		return false;
+
+	if (!out.Bytes(literals, literalLength))
+		return false;
+
+	if (matchLength == 0)
+		return true;
+
+	if (!out.Byte(static_cast<uint8_t>(offset)) || !out.Byte(static_cast<uint8_t>(offset >> 8)))
+		return false;
+
+	return matchCode < kRunMask || out.Length(matchCode - kRunMask);
+}
+
+} // namespace detail
+
+std::size_t Compress(std::span<const std::byte> src, std::span<std::byte> dst) noexcept
+{
+	using namespace detail;
+
+	ZoneScoped;
+
+	const auto* data = reinterpret_cast<const uint8_t*>(src.data());
+	const auto size = src.size();
+
+	Writer out(reinterpret_cast<uint8_t*>(dst.data()), reinterpret_cast<uint8_t*>(dst.data()) + dst.size());
+
+	std::size_t anchor = 0;
+
+	if (size > kMatchSafeDistance)
+	{
+		std::array<uint32_t, 1U << kHashLog> table{};
+
+		const auto matchLimit = size - kLastLiterals;
+		const auto inputLimit = size - kMatchSafeDistance;
+
+		for (std::size_t pos = 0; pos <= inputLimit;)
+		{
+			auto sequence = Load32(data + pos);
+			auto& slot = table[Hash(sequence)];
+			std::size_t ref = slot;
+			slot = static_cast<uint32_t>(pos);
+
+			if (ref >= pos || pos - ref > kMaxOffset || Load32(data + ref) != sequence)
+			{
+				// skip faster through data that does not match, like lz4 does
+				pos += 1 + ((pos - anchor) >> 6);
+				continue;
+			}
+
+			while (pos > anchor && ref > 0 && data[pos - 1] == data[ref - 1])
+			{
+				pos--;
+				ref--;
+			}
+
+			auto length = kMinMatch;
+			while (pos + length < matchLimit && data[pos + length] == data[ref + length])
+				length++;
+
+			if (!WriteSequence(out, data + anchor, pos - anchor, pos - ref, length))
+				return 0;
+
+			pos += length;
+			anchor = pos;
+
+			// the position just before the next one is a likely match candidate too
+			if (pos - 2 <= inputLimit)
+				table[Hash(Load32(data + pos - 2))] = static_cast<uint32_t>(pos - 2);
+		}
+	}
+
+	if (!WriteSequence(out, data + anchor, size - anchor, 0, 0))
+		return 0;
+
+	return static_cast<std::size_t>(out.Ptr() - reinterpret_cast<uint8_t*>(dst.data()));
+}
+
+std::expected<void, std::error_code> Decompress(std::span<const std::byte> src, std::span<std::byte> dst) noexcept
+{
+	using namespace detail;
+
+	ZoneScoped;
+
+	const auto* in = reinterpret_cast<const uint8_t*>(src.data());
+	const auto* inEnd = in + src.size();
+	auto* const outBegin = reinterpret_cast<uint8_t*>(dst.data());
+	auto* out = outBegin;
+	auto* const outEnd = outBegin + dst.size();
+
+	const auto kError = std::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+
+	auto readLength = [&in, inEnd](std::size_t& length) noexcept
+	{
+		uint8_t value;
+		do
+		{
+			if (in == inEnd)
+				return false;
+
+			value = *in++;
+			length += value;
+		} while (value == 255);
+
+		return true;
+	};
+
+	for (;;)
+	{
+		if (in == inEnd)
+			return kError;
+
+		auto token = *in++;
+
+		std::size_t literalLength = token >> 4;
+		if (literalLength == kRunMask && !readLength(literalLength))
+			return kError;
+
+		if (static_cast<std::size_t>(inEnd - in) < literalLength || static_cast<std::size_t>(outEnd - out) < literalLength)
+			return kError;
+
+		if (literalLength != 0)
+			std::memcpy(out, in, literalLength);
+
+		in += literalLength;
+		out += literalLength;
+
+		// the last sequence has no match
+		if (in == inEnd)
+			break;
+
+		if (inEnd - in < 2)
+			return kError;
+
+		std::size_t offset = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+		in += 2;
+
+		if (offset == 0 || offset > static_cast<std::size_t>(out - outBegin))
+			return kError;
+
+		std::size_t matchLength = token & kRunMask;
+		if (matchLength == kRunMask && !readLength(matchLength))
+			return kError;
+
+		matchLength += kMinMatch;
+
+		if (static_cast<std::size_t>(outEnd - out) < matchLength)
+			return kError;
+
+		const auto* match = out - offset;
+
+		if (offset >= matchLength)
+		{
+			std::memcpy(out, match, matchLength);
+			out += matchLength;
+		}
+		else
+		{
+			// overlapping, e.g. runs of a repeated byte
+			for (auto* matchEnd = out + matchLength; out != matchEnd;)
+				*out++ = *match++;
+		}
+	}
+
+	if (out != outEnd)
+		return kError;
+
+	return {};
+}
+
+} // namespace compression
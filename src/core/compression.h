@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <system_error>
+
+namespace compression
+{
+
+enum class Codec : uint8_t
+{
+	kNone,
+	kLz // lz4 block format: byte oriented lz77, with no entropy coding. decodes at memory bandwidth
+};
+
+// worst case size of Compress output, for incompressible input
+[[nodiscard]] constexpr std::size_t CompressBound(std::size_t size) noexcept { return size + size / 255 + 16; }
+
+// greedy, single probe hash chain compressor. returns the number of bytes written to dst, or 0 if they did not fit.
+// pass a dst smaller than src to only get output that is worth keeping.
+[[nodiscard]] std::size_t Compress(std::span<const std::byte> src, std::span<std::byte> dst) noexcept;
+
+// dst.size() needs to be the exact decompressed size. malformed input fails with std::errc::illegal_byte_sequence,
+// and is never read or written out of bounds.
+[[nodiscard]] std::expected<void, std::error_code> Decompress(std::span<const std::byte> src, std::span<std::byte> dst) noexcept;
+
+} // namespace compression
@@ -0,0 +1,75 @@
+#include "coroutine.h"
+#include "memorypool.h"
+
+#include <new>
+
+namespace core
+{
+namespace detail
+{
+
+template <std::size_t Size>
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) CoroutineFrameBlock
+{
+	std::array<std::byte, Size> data;
+};
+
+static MemoryPool<CoroutineFrameBlock<256>, (1 << 14), MemoryPoolMode::kLockFree, 256> gCoroutineFramePoolSmall;
+static MemoryPool<CoroutineFrameBlock<1024>, (1 << 12), MemoryPoolMode::kLockFree, 64> gCoroutineFramePoolMedium;
+static MemoryPool<CoroutineFrameBlock<4096>, (1 << 10), MemoryPoolMode::kLockFree, 16> gCoroutineFramePoolLarge;
+
+template <typename Pool>
+static void* InternalAllocateFromPool(Pool& pool) noexcept
+{
+	auto handle = pool.Allocate();
+
+	return handle ? pool.GetPointer(handle) : nullptr;
+}
+
+template <typename Pool, typename Block>
+static bool InternalTryFreeToPool(Pool& pool, Block* ptr) noexcept
+{
+	auto handle = pool.GetHandle(ptr);
+
+	if (!handle)
+		return false; // was allocated from the heap because the pool was full
+
+	pool.Free(handle);
+
+	return true;
+}
+
+void* InternalAllocateCoroutineFrame(std::size_t size) noexcept
+{
+	void* ptr = nullptr;
+
+	if (size <= sizeof(CoroutineFrameBlock<256>))
+		ptr = InternalAllocateFromPool(gCoroutineFramePoolSmall);
+	else if (size <= sizeof(CoroutineFrameBlock<1024>))
+		ptr = InternalAllocateFromPool(gCoroutineFramePoolMedium);
+	else if (size <= sizeof(CoroutineFrameBlock<4096>))
+		ptr = InternalAllocateFromPool(gCoroutineFramePoolLarge);
+
+	return ptr != nullptr ? ptr : ::operator new(size, std::nothrow);
+}
+
+void InternalFreeCoroutineFrame(void* ptr, std::size_t size) noexcept
+{
+	if (ptr == nullptr)
+		return;
+
+	bool freed = false;
+
+	if (size <= sizeof(CoroutineFrameBlock<256>))
+		freed = InternalTryFreeToPool(gCoroutineFramePoolSmall, static_cast<CoroutineFrameBlock<256>*>(ptr));
+	else if (size <= sizeof(CoroutineFrameBlock<1024>))
+		freed = InternalTryFreeToPool(gCoroutineFramePoolMedium, static_cast<CoroutineFrameBlock<1024>*>(ptr));
+	else if (size <= sizeof(CoroutineFrameBlock<4096>))
+		freed = InternalTryFreeToPool(gCoroutineFramePoolLarge, static_cast<CoroutineFrameBlock<4096>*>(ptr));
+
+	if (!freed)
+		::operator delete(ptr);
+}
+
+} // namespace detail
+} // namespace core
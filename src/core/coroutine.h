@@ -0,0 +1,107 @@
+#pragma once
+
+#include "task.h"
+#include "taskexecutor.h"
+
+#include <coroutine>
+#include <optional>
+#include <type_traits>
+
+template <typename T>
+class Coroutine;
+
+// schedules the coroutine to start on the executor. the returned future is ready once the coroutine has returned.
+template <typename T>
+[[nodiscard]] Future<T> Spawn(TaskExecutor& executor, Coroutine<T>&& coroutine, TaskPriority priority = kTaskPriorityNormal) noexcept;
+
+// frames are allocated from size-classed task system pools (falls back to the global heap for large frames).
+struct CoroutinePromiseBase
+{
+	[[nodiscard]] static void* operator new(std::size_t size) noexcept;
+	static void operator delete(void* ptr, std::size_t size) noexcept;
+
+	[[nodiscard]] std::suspend_always initial_suspend() const noexcept { return {}; }
+
+	struct FinalAwaiter
+	{
+		[[nodiscard]] bool await_ready() const noexcept { return false; }
+		template <typename Promise>
+		void await_suspend(std::coroutine_handle<Promise> coroutine) noexcept;
+		void await_resume() const noexcept {}
+	};
+	[[nodiscard]] FinalAwaiter final_suspend() const noexcept { return {}; }
+
+	// the coroutine still completes, and the exception is rethrown by Get on the spawned future
+	void unhandled_exception() const noexcept;
+
+	TaskExecutor* executor = nullptr;
+	TaskHandle completion; // submitted when the coroutine has returned. destroys the frame and completes the spawned future.
+	TaskPriority priority = kTaskPriorityNormal; // used for all resumptions of the coroutine
+};
+
+template <typename T>
+struct CoroutinePromise : CoroutinePromiseBase
+{
+	[[nodiscard]] Coroutine<T> get_return_object() noexcept;
+	[[nodiscard]] static Coroutine<T> get_return_object_on_allocation_failure() noexcept { return {}; }
+
+	template <typename U = T>
+	void return_value(U&& value) noexcept(std::is_nothrow_constructible_v<T, U>) { this->value.emplace(std::forward<U>(value)); }
+
+	std::optional<T> value;
+};
+
+template <>
+struct CoroutinePromise<void> : CoroutinePromiseBase
+{
+	[[nodiscard]] Coroutine<void> get_return_object() noexcept;
+	[[nodiscard]] static Coroutine<void> get_return_object_on_allocation_failure() noexcept;
+
+	void return_void() const noexcept {}
+};
+
+// Lazily started coroutine that runs on a TaskExecutor. Use co_await on a Future<T> inside the coroutine
+// to wait for other tasks without blocking a worker thread.
+//
+// Coroutine<int> CountLines(TaskExecutor& executor, std::filesystem::path path)
+// {
+//		auto text = co_await Spawn(executor, ReadText(executor, path));
+//		co_return std::ranges::count(text, '\n');
+// }
+template <typename T = void>
+class [[nodiscard]] Coroutine final
+{
+	template <typename U>
+	friend Future<U> Spawn(TaskExecutor& executor, Coroutine<U>&& coroutine, TaskPriority priority) noexcept;
+
+public:
+	using promise_type = CoroutinePromise<T>;
+	using handle_type = std::coroutine_handle<promise_type>;
+
+	constexpr Coroutine() noexcept = default;
+	explicit Coroutine(handle_type handle) noexcept : myHandle(handle) {}
+	Coroutine(const Coroutine&) = delete;
+	Coroutine(Coroutine&& other) noexcept : myHandle(std::exchange(other.myHandle, {})) {}
+	~Coroutine() noexcept;
+
+	Coroutine& operator=(const Coroutine&) = delete;
+	Coroutine& operator=(Coroutine&& other) noexcept;
+
+	[[nodiscard]] bool Valid() const noexcept { return !!myHandle; }
+
+private:
+	handle_type myHandle;
+};
+
+namespace core
+{
+namespace detail
+{
+
+[[nodiscard]] void* InternalAllocateCoroutineFrame(std::size_t size) noexcept;
+void InternalFreeCoroutineFrame(void* ptr, std::size_t size) noexcept;
+
+} // namespace detail
+} // namespace core
+
+#include "coroutine.inl"
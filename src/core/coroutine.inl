@@ -0,0 +1,107 @@
+#include "assert.h"//NOLINT(modernize-deprecated-headers)
+
+inline void* CoroutinePromiseBase::operator new(std::size_t size) noexcept
+{
+	return core::detail::InternalAllocateCoroutineFrame(size);
+}
+
+inline void CoroutinePromiseBase::operator delete(void* ptr, std::size_t size) noexcept
+{
+	core::detail::InternalFreeCoroutineFrame(ptr, size);
+}
+
+template <typename Promise>
+void CoroutinePromiseBase::FinalAwaiter::await_suspend(std::coroutine_handle<Promise> coroutine) noexcept
+{
+	auto& promise = coroutine.promise();
+
+	ENSUREF(promise.executor != nullptr, "Coroutine has not been spawned!");
+
+	// the completion task destroys the frame, so copy what we need first
+	auto* executor = promise.executor;
+	auto completion = promise.completion;
+
+	executor->Submit({&completion, 1});
+}
+
+inline void CoroutinePromiseBase::unhandled_exception() const noexcept
+{
+	ENSUREF(executor != nullptr, "Coroutine has not been spawned!");
+
+	// the completion task has not run yet, so its state is still ours to write
+	core::detail::InternalHandleToState(completion)->exception = std::current_exception();
+}
+
+template <typename T>
+Coroutine<T> CoroutinePromise<T>::get_return_object() noexcept
+{
+	return Coroutine<T>(std::coroutine_handle<CoroutinePromise<T>>::from_promise(*this));
+}
+
+inline Coroutine<void> CoroutinePromise<void>::get_return_object() noexcept
+{
+	return Coroutine<void>(std::coroutine_handle<CoroutinePromise<void>>::from_promise(*this));
+}
+
+inline Coroutine<void> CoroutinePromise<void>::get_return_object_on_allocation_failure() noexcept
+{
+	return {};
+}
+
+template <typename T>
+Coroutine<T>::~Coroutine() noexcept
+{
+	if (myHandle)
+		myHandle.destroy();
+}
+
+template <typename T>
+Coroutine<T>& Coroutine<T>::operator=(Coroutine&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (myHandle)
+			myHandle.destroy();
+
+		myHandle = std::exchange(other.myHandle, {});
+	}
+
+	return *this;
+}
+
+template <typename T>
+Future<T> Spawn(TaskExecutor& executor, Coroutine<T>&& coroutine, TaskPriority priority) noexcept
+{
+	ENSUREF(coroutine.Valid(), "Coroutine is not valid!");
+
+	auto handle = std::exchange(coroutine.myHandle, {});
+	auto& promise = handle.promise();
+
+	promise.executor = &executor;
+	promise.priority = priority;
+
+	auto [completionHandle, completionFuture] = CreateTask([handle]() -> T
+	{
+		if constexpr (std::is_void_v<T>)
+		{
+			handle.destroy();
+		}
+		else
+		{
+			// no value if the coroutine exited with an exception
+			auto& promiseValue = handle.promise().value;
+			T value = promiseValue ? std::move(*promiseValue) : T{};
+			handle.destroy();
+			return value;
+		}
+	});
+	SetPriority(completionHandle, priority);
+	promise.completion = completionHandle;
+
+	auto [startHandle, startFuture] = CreateTask([handle] { handle.resume(); });
+	SetPriority(startHandle, priority);
+
+	executor.Submit({&startHandle, 1});
+
+	return completionFuture;
+}
@@ -1,7 +1,19 @@
+#include "assetcache.h"
+#include "coroutine.h"
 #include "file.h"
+#include "taskexecutor.h"
 
+#include <algorithm>
 #include <ctime>
 #include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <vector>
+
+#include <xxhash.h>
 
 namespace file
 {
@@ -22,6 +34,119 @@ const char* ToString(AssetManifestErrorCode code) noexcept
 	return "Unknown";
 }
 
+using Sha256Digest = std::array<uint8_t, 32>;
+
+static Sha256Digest Sha256(uint8_t prefix, std::span<const uint8_t> first, std::span<const uint8_t> second = {})
+{
+	picosha2::hash256_one_by_one hasher;
+	hasher.process(&prefix, &prefix + 1);
+	hasher.process(first.begin(), first.end());
+	hasher.process(second.begin(), second.end());
+	hasher.finish();
+
+	Sha256Digest digest;
+	hasher.get_hash_bytes(digest.begin(), digest.end());
+
+	return digest;
+}
+
+static Sha256Digest Sha256Tree(std::span<const uint8_t> data)
+{
+	ZoneScopedN("Sha256Tree");
+
+	auto chunkCount = std::max<std::size_t>((data.size() + kChecksumChunkSize - 1) / kChecksumChunkSize, 1);
+	std::vector<Sha256Digest> level(chunkCount);
+
+	auto hashChunk = [data, &level](std::size_t chunkIt)
+	{
+		level[chunkIt] = Sha256(0x00, data.subspan(chunkIt * kChecksumChunkSize, std::min(kChecksumChunkSize, data.size() - chunkIt * kChecksumChunkSize)));
+	};
+
+	if (auto app = gApplication.lock(); app && chunkCount > 1)
+		app->GetExecutor().ParallelFor(std::views::iota(std::size_t{0}, chunkCount), 1, hashChunk);
+	else
+		std::ranges::for_each(std::views::iota(std::size_t{0}, chunkCount), hashChunk);
+
+	// the inner levels are only a few digests per GiB, no point going wide
+	while (level.size() > 1)
+	{
+		std::vector<Sha256Digest> parents((level.size() + 1) / 2);
+
+		for (std::size_t parentIt = 0; parentIt < parents.size(); parentIt++)
+		{
+			auto leftIt = parentIt * 2;
+			parents[parentIt] = (leftIt + 1 < level.size()) ? Sha256(0x01, level[leftIt], level[leftIt + 1]) : level[leftIt];
+		}
+
+		level = std::move(parents);
+	}
+
+	return level.front();
+}
+
+// the source asset is hashed cryptographically (but in parallel), the cache blob only needs to be validated
+static constexpr auto kAssetChecksumMode = ChecksumMode::kSha256Tree;
+static constexpr auto kCacheChecksumMode = ChecksumMode::kXxh3128;
+
+std::string GetChecksum(std::span<const uint8_t> data, ChecksumMode mode)
+{
+	ZoneScoped;
+
+	switch (mode)
+	{
+	case ChecksumMode::kNone:
+		return {};
+	case ChecksumMode::kSha256:
+	{
+		Sha256Digest digest;
+		picosha2::hash256(data.begin(), data.end(), digest.begin(), digest.end());
+		return picosha2::bytes_to_hex_string(digest.cbegin(), digest.cend());
+	}
+	case ChecksumMode::kSha256Tree:
+	{
+		auto digest = Sha256Tree(data);
+		return picosha2::bytes_to_hex_string(digest.cbegin(), digest.cend());
+	}
+	case ChecksumMode::kXxh3128:
+	{
+		XXH128_canonical_t canonical;
+		XXH128_canonicalFromHash(&canonical, XXH3_128bits(data.data(), data.size()));
+		return picosha2::bytes_to_hex_string(std::cbegin(canonical.digest), std::cend(canonical.digest));
+	}
+	}
+
+	return {};
+}
+
+uint64_t GetContentHash(std::span<const std::byte> data) noexcept
+{
+	return XXH3_64bits(data.data(), data.size());
+}
+
+std::expected<void, std::error_code> WriteFile(const std::string& filePath, std::span<const std::byte> data)
+{
+	ZoneScoped;
+
+	std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return std::unexpected(std::make_error_code(std::errc::io_error));
+
+	if (!file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size())))
+		return std::unexpected(std::make_error_code(std::errc::io_error));
+
+	return {};
+}
+
+ObjectWatch::ObjectWatch(Watcher& watcher, const std::filesystem::path& filePath)
+: watcher(watcher)
+, id(watcher.Add(filePath, [this] { changed.store(true, std::memory_order_release); }))
+{}
+
+ObjectWatch::~ObjectWatch()
+{
+	watcher.Remove(id);
+}
+
 } // namespace detail
 
 std::expected<std::string, std::error_code>
@@ -78,19 +203,204 @@ GetCanonicalPath(const char* pathStr, const char* defaultPathStr, bool createIfM
 	return path;
 }
 
-std::expected<Record, std::error_code> LoadAsset(
-	const std::filesystem::path& assetFilePath,
-	const LoadFn& loadSourceFileFn,
-	const LoadFn& loadBinaryCacheFn,
-	const SaveFn& saveBinaryCacheFn,
-	const std::string& parameterHash)
+namespace detail
+{
+
+// one import of (assetFilePath, parameterHash), shared by all concurrent LoadAsset(Async) calls for it
+struct AssetImport
+{
+	std::string key;
+	std::filesystem::path assetFilePath;
+	std::string parameterHash;
+	LoadFn loadSourceFileFn;
+	SaveFn saveBinaryCacheFn;
+	Future<void> done;
+	std::expected<AssetManifest, std::error_code> manifest; // valid once done is ready
+	std::string cacheKey; // of the blob pinned for the loads sharing the import, until the last of them has read it
+
+	~AssetImport()
+	{
+		if (cacheKey.empty())
+			return;
+
+		if (auto app = gApplication.lock())
+			app->GetAssetCache()->Unpin(cacheKey);
+	}
+};
+
+static std::mutex gAssetImportsMutex;
+static UnorderedMap<std::string, std::shared_ptr<AssetImport>> gAssetImports; // protected by gAssetImportsMutex
+
+// runs fn(chunkIt) for every chunk, in parallel on the application executor if there is more than one
+template <typename F>
+static void ForEachChunk(std::size_t chunkCount, F&& fn)
+{
+	if (auto app = gApplication.lock(); app && chunkCount > 1)
+		app->GetExecutor().ParallelFor(std::views::iota(std::size_t{0}, chunkCount), 1, std::forward<F>(fn));
+	else
+		std::ranges::for_each(std::views::iota(std::size_t{0}, chunkCount), fn);
+}
+
+// rewrites the raw blob at filePath in its final encoding, followed by the encoding itself
+std::expected<CacheEncoding, std::error_code> EncodeCacheBlob(const std::filesystem::path& filePath, compression::Codec codec)
+{
+	ZoneScoped;
+
+	std::error_code error;
+	auto size = std::filesystem::file_size(filePath, error);
+	if (error)
+		return std::unexpected(error);
+
+	CacheEncoding encoding{.codec = codec, .chunkSize = 0, .size = size, .chunks = {}};
+	std::vector<std::vector<std::byte>> chunks;
+
+	if (codec != compression::Codec::kNone)
+	{
+		encoding.chunkSize = kCacheChunkSize;
+		chunks.resize((size + kCacheChunkSize - 1) / kCacheChunkSize);
+
+		// intended scope - the mapping needs to be closed before the file is rewritten
+		if (!chunks.empty())
+		{
+			auto blob = mio::basic_mmap_source<std::byte>();
+			blob.map(filePath.string(), error);
+			if (error)
+				return std::unexpected(error);
+
+			auto data = std::span<const std::byte>(blob.data(), blob.size());
+
+			ForEachChunk(chunks.size(), [data, &chunks](std::size_t chunkIt)
+			{
+				auto chunk = data.subspan(chunkIt * kCacheChunkSize, std::min(kCacheChunkSize, data.size() - chunkIt * kCacheChunkSize));
+				auto& encoded = chunks[chunkIt];
+
+				// output that is not smaller than the input is not worth decompressing, so such chunks are stored as is
+				encoded.resize(chunk.size());
+				if (auto encodedSize = compression::Compress(chunk, std::span(encoded).first(chunk.size() - 1)); encodedSize != 0)
+					encoded.resize(encodedSize);
+				else
+					std::ranges::copy(chunk, encoded.begin());
+			});
+		}
+
+		for (const auto& chunk : chunks)
+			encoding.chunks.push_back(static_cast<uint32_t>(chunk.size()));
+	}
+
+	std::vector<std::byte> trailer;
+	auto outStream = zpp::bits::out(trailer);
+
+	if (auto result = outStream(encoding); failure(result))
+		return std::unexpected(std::make_error_code(result));
+
+	if (auto result = outStream(static_cast<uint32_t>(outStream.position())); failure(result))
+		return std::unexpected(std::make_error_code(result));
+
+	// uncompressed data stays where it is, and only gets the trailer appended
+	std::ofstream file(filePath, std::ios::binary | (codec == compression::Codec::kNone ? std::ios::app : std::ios::trunc));
+
+	auto write = [&file](std::span<const std::byte> data)
+	{
+		return static_cast<bool>(file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size())));
+	};
+
+	if (!file || !std::ranges::all_of(chunks, write) || !write(trailer))
+		return std::unexpected(std::make_error_code(std::errc::io_error));
+
+	return encoding;
+}
+
+std::expected<CacheEncoding, std::error_code> LoadCacheEncoding(const std::filesystem::path& filePath)
+{
+	ZoneScoped;
+
+	auto file = mio::basic_mmap_source<std::byte>();
+	std::error_code error;
+	file.map(filePath.string(), error);
+	if (error)
+		return std::unexpected(error);
+
+	auto blob = std::span<const std::byte>(file.data(), file.size());
+
+	uint32_t encodingSize = 0;
+	if (blob.size() < sizeof(encodingSize))
+		return std::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+
+	std::memcpy(&encodingSize, blob.data() + blob.size() - sizeof(encodingSize), sizeof(encodingSize));
+	if (encodingSize > blob.size() - sizeof(encodingSize))
+		return std::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+
+	return LoadObject<CacheEncoding>(blob.subspan(blob.size() - sizeof(encodingSize) - encodingSize, encodingSize));
+}
+
+// decodes the data of blob, decompressing its chunks in parallel, and hands it to loadFn
+std::error_code DecodeCacheBlob(std::span<const std::byte> blob, const CacheEncoding& encoding, const LoadFn& loadFn)
+{
+	ZoneScoped;
+
+	const auto kInvalid = std::make_error_code(std::errc::illegal_byte_sequence);
+
+	if (encoding.codec == compression::Codec::kNone)
+	{
+		if (encoding.size > blob.size())
+			return kInvalid;
+
+		auto data = blob.first(encoding.size);
+		auto inStream = InputSerializer(data);
+
+		return loadFn(inStream);
+	}
+
+	if (encoding.chunkSize == 0 || encoding.chunks.size() != (encoding.size + encoding.chunkSize - 1) / encoding.chunkSize)
+		return kInvalid;
+
+	std::vector<uint64_t> offsets(encoding.chunks.size() + 1);
+	for (std::size_t chunkIt = 0; chunkIt < encoding.chunks.size(); chunkIt++)
+		offsets[chunkIt + 1] = offsets[chunkIt] + encoding.chunks[chunkIt];
+
+	if (offsets.back() > blob.size())
+		return kInvalid;
+
+	std::vector<std::byte> decoded(encoding.size);
+	std::atomic_bool failed = false;
+
+	ForEachChunk(encoding.chunks.size(), [blob, &encoding, &offsets, &decoded, &failed](std::size_t chunkIt)
+	{
+		auto chunk = std::span(decoded).subspan(
+			chunkIt * encoding.chunkSize,
+			std::min<uint64_t>(encoding.chunkSize, encoding.size - chunkIt * encoding.chunkSize));
+		auto encoded = blob.subspan(offsets[chunkIt], encoding.chunks[chunkIt]);
+
+		if (encoded.size() == chunk.size())
+			std::ranges::copy(encoded, chunk.begin());
+		else if (!compression::Decompress(encoded, chunk))
+			failed.store(true, std::memory_order_relaxed);
+	});
+
+	if (failed)
+		return kInvalid;
+
+	auto data = std::span<const std::byte>(decoded);
+	auto inStream = InputSerializer(data);
+
+	return loadFn(inStream);
+}
+
+// validates the manifest of the asset (reimporting the source file if needed), and returns it. the cache blob of the returned
+// manifest is pinned in the asset cache.
+static std::expected<AssetManifest, std::error_code> ImportAsset(const AssetImport& import)
 {
-	using namespace detail;
-	
 	ZoneScoped;
 
-	auto rootPath = std::get<std::filesystem::path>(gApplication.lock()->GetEnv().variables["RootPath"]);
-	auto cacheDir = std::get<std::filesystem::path>(gApplication.lock()->GetEnv().variables["UserProfilePath"]);
+	const auto& assetFilePath = import.assetFilePath;
+	const auto& parameterHash = import.parameterHash;
+	const auto& loadSourceFileFn = import.loadSourceFileFn;
+	const auto& saveBinaryCacheFn = import.saveBinaryCacheFn;
+
+	auto app = gApplication.lock();
+	auto& variables = app->GetEnv().variables;
+	auto rootPath = std::get<std::filesystem::path>(variables["RootPath"]);
+	auto cacheDir = std::get<std::filesystem::path>(variables["UserProfilePath"]);
 	auto cacheDirStatus = std::filesystem::status(cacheDir);
 	if (!std::filesystem::exists(cacheDirStatus) ||
 		!std::filesystem::is_directory(cacheDirStatus))
@@ -105,13 +415,19 @@ std::expected<Record, std::error_code> LoadAsset(
 
 	auto manifestStatus = std::filesystem::status(manifestPath);
 
-	auto importSourceFile = [&cacheDir, &manifestPath, &assetFilePath, &loadSourceFileFn, &saveBinaryCacheFn]() -> std::expected<AssetManifest, std::error_code>
+	auto* assetCache = app->GetAssetCache();
+	ENSURE(assetCache != nullptr);
+
+	// "AssetCacheCompression" (bool) stores new cache blobs compressed, which is the default
+	auto codec = compression::Codec::kLz;
+	if (auto it = variables.find("AssetCacheCompression"); it != variables.end())
+		if (const auto* value = std::get_if<bool>(&it->second))
+			codec = *value ? compression::Codec::kLz : compression::Codec::kNone;
+
+	auto importSourceFile = [&manifestPath, &assetFilePath, &loadSourceFileFn, &saveBinaryCacheFn, &parameterHash, assetCache, codec]() -> std::expected<AssetManifest, std::error_code>
 	{
 		ZoneScopedN("LoadAsset::importSourceFile");
 
-		auto uuid = uuids::uuid_system_generator{}();
-		auto uuidStr = uuids::to_string(uuid);
-
 		std::error_code error;
 
 		auto parentPath = manifestPath.parent_path();
@@ -123,36 +439,76 @@ std::expected<Record, std::error_code> LoadAsset(
 		if (error)
 			return std::unexpected(error);
 
-		auto manifestFile = mio_extra::resizeable_mmap_sink<std::byte>();
-		manifestFile.map(manifestPath.string(), error);
-
-		if (error)
-			return std::unexpected(error);
-
-		auto asset = LoadBinary<true>(assetFilePath, loadSourceFileFn);
+		auto asset = GetRecord<kAssetChecksumMode>(assetFilePath);
 		if (!asset)
 			return std::unexpected(asset.error());
 
-		auto cache = SaveBinary<true>(cacheDir / uuidStr, saveBinaryCacheFn);
-		if (!cache)
-			return std::unexpected(cache.error());
+		// identical sources imported with identical parameters share one blob, so only the first of them pays for the import
+		auto key = AssetCache::MakeKey(asset->checksum, parameterHash);
 
-		AssetManifest manifest{.assetFileInfo = asset.value(), .cacheFileInfo=cache.value()};
+		std::expected<Record, std::error_code> cache = std::unexpected(std::make_error_code(std::errc::no_such_file_or_directory));
+		std::expected<CacheEncoding, std::error_code> encoding = std::unexpected(cache.error());
 
-		auto outStream = zpp::bits::out(manifestFile, zpp::bits::no_fit_size{}, zpp::bits::no_enlarge_overflow{});
+		// blobs without a readable encoding (e.g. from before blobs had one) are replaced below
+		if (assetCache->Pin(key))
+		{
+			cache = GetRecord<kCacheChecksumMode>(assetCache->GetPath(key));
+			if (cache)
+				encoding = LoadCacheEncoding(cache->path);
 
-		if (auto result = outStream(manifest); failure(result))
-			return std::unexpected(std::make_error_code(result));
+			if (!cache || !encoding)
+				assetCache->Unpin(key);
+		}
 
-		manifestFile.truncate(outStream.position(), error);
+		if (!cache || !encoding)
+		{
+			if (auto source = LoadBinary<ChecksumMode::kNone>(assetFilePath, loadSourceFileFn); !source)
+				return std::unexpected(source.error());
 
-		if (error)
-			return std::unexpected(error);
+			auto stagingPath = assetCache->GetStagingPath(key);
+
+			encoding = SaveBinary<ChecksumMode::kNone>(stagingPath, saveBinaryCacheFn)
+				.and_then([&stagingPath, codec](const Record&) { return EncodeCacheBlob(stagingPath, codec); });
+
+			if (encoding)
+				cache = GetRecord<kCacheChecksumMode>(stagingPath);
+			else
+				cache = std::unexpected(encoding.error());
+
+			if (cache)
+			{
+				if (auto path = assetCache->Insert(key, stagingPath); path)
+					cache->path = path.value();
+				else
+					cache = std::unexpected(path.error());
+			}
+
+			if (!cache)
+				std::filesystem::remove(stagingPath, error);
+		}
+
+		if (!cache)
+			return std::unexpected(cache.error());
+
+		AssetManifest manifest{.assetFileInfo = asset.value(), .cacheFileInfo = cache.value(), .cacheEncoding = encoding.value()};
+
+		if (auto result = SaveObject(manifest, manifestPath.string()); !result)
+		{
+			assetCache->Unpin(key);
+			return std::unexpected(result.error());
+		}
 
 		return manifest;
 	};
 
+	// "AssetParanoidValidation" (bool) rehashes every source and cache file, instead of trusting unchanged sizes and last write times
+	bool paranoid = false;
+	if (auto it = variables.find("AssetParanoidValidation"); it != variables.end())
+		if (const auto* value = std::get_if<bool>(&it->second))
+			paranoid = *value;
+
 	std::expected<AssetManifest, AssetManifestError> manifest;
+	bool refreshed = false;
 
 	if (std::filesystem::exists(manifestStatus) && std::filesystem::is_regular_file(manifestStatus))
 	{
@@ -164,15 +520,26 @@ std::expected<Record, std::error_code> LoadAsset(
 		if (error)
 			return std::unexpected(error);
 
-		manifest = LoadAssetManifest<false>(
+		manifest = LoadAssetManifest<kAssetChecksumMode, kCacheChecksumMode>(
 			std::span<const std::byte>(manifestFile.data(), manifestFile.size()),
-			[](std::span<const std::byte> buffer) { return LoadObject<AssetManifest>(buffer); });
+			[](std::span<const std::byte> buffer) { return LoadObject<AssetManifest>(buffer); },
+			paranoid,
+			refreshed);
 	}
 	else
 	{
 		manifest = std::unexpected(AssetManifestErrorCode::kMissing);
 	}
 
+	// manifests from before the asset cache point at blobs outside of it, which nothing would ever evict
+	if (manifest && !assetCache->Pin(std::filesystem::path(manifest->cacheFileInfo.path).filename().string()))
+	{
+		if (std::filesystem::path cacheFilePath(manifest->cacheFileInfo.path); cacheFilePath.parent_path() != assetCache->GetDirectory())
+			std::filesystem::remove(cacheFilePath, error);
+
+		manifest = std::unexpected(AssetManifestErrorCode::kInvalidCacheFile);
+	}
+
 	if (!manifest)
 	{
 		if (std::holds_alternative<AssetManifestErrorCode>(manifest.error()))
@@ -194,11 +561,163 @@ std::expected<Record, std::error_code> LoadAsset(
 			manifest = result;
 		else
 			return std::unexpected(result.error());
+	}
+
+	if (refreshed)
+	{
+		ZoneScopedN("LoadAsset::SaveAssetManifest");
+
+		// a failure here only costs us a rehash next time
+		if (auto result = SaveObject(manifest.value(), manifestPath.string()); !result)
+			std::cerr << "Failed to update asset manifest: " << result.error().message() << ", Path: " << manifestPath << '\n';
+	}
+
+	return manifest.value();
+}
+
+// returns the import in flight for (assetFilePath, parameterHash), or a new one together with the (unsubmitted) task running it
+static std::pair<std::shared_ptr<AssetImport>, std::optional<TaskHandle>> BeginImportAsset(
+	const std::filesystem::path& assetFilePath,
+	const LoadFn& loadSourceFileFn,
+	const SaveFn& saveBinaryCacheFn,
+	const std::string& parameterHash)
+{
+	auto key = assetFilePath.lexically_normal().string();
+	key.push_back('\0');
+	key.append(parameterHash);
+
+	std::unique_lock lock(gAssetImportsMutex);
+
+	if (auto it = gAssetImports.find(key); it != gAssetImports.end())
+		return {it->second, std::nullopt};
+
+	auto import = std::make_shared<AssetImport>(AssetImport{
+		.key = key,
+		.assetFilePath = assetFilePath,
+		.parameterHash = parameterHash,
+		.loadSourceFileFn = loadSourceFileFn,
+		.saveBinaryCacheFn = saveBinaryCacheFn});
+
+	auto [task, future] = CreateTask([import]
+	{
+		ZoneScopedN("LoadAsset::import");
 
-		return manifest->cacheFileInfo;
+		import->manifest = ImportAsset(*import);
+		if (import->manifest)
+			import->cacheKey = std::filesystem::path(import->manifest->cacheFileInfo.path).filename().string();
+
+		// later requests start over, and find the manifest written by this import
+		std::unique_lock lock(gAssetImportsMutex);
+		gAssetImports.erase(import->key);
+	});
+
+	import->done = std::move(future);
+	gAssetImports.emplace(std::move(key), import);
+
+	return {std::move(import), task};
+}
+
+static Coroutine<std::expected<void, std::error_code>> LoadAssetCoroutine(std::shared_ptr<AssetImport> import, LoadFn loadBinaryCacheFn)
+{
+	co_await import->done;
+
+	if (!import->manifest)
+		co_return std::unexpected(import->manifest.error());
+
+	const auto& cache = import->manifest->cacheFileInfo;
+
+	// read through the async reader instead of mapping the blob, so that a cold cache does not stall a worker on page faults
+	std::vector<std::byte> blob(cache.size);
+	std::array buffers{std::span<std::byte>(blob)};
+
+	auto read = co_await gApplication.lock()->GetAsyncReader().Read(cache.path, 0, buffers);
+	if (!read)
+		co_return std::unexpected(read.error());
+
+	if (read.value() != blob.size())
+		co_return std::unexpected(std::make_error_code(std::errc::io_error));
+
+	if (auto error = DecodeCacheBlob(blob, import->manifest->cacheEncoding, loadBinaryCacheFn))
+		co_return std::unexpected(error);
+
+	co_return std::expected<void, std::error_code>{};
+}
+
+} // namespace detail
+
+std::expected<Record, std::error_code> LoadAsset(
+	const std::filesystem::path& assetFilePath,
+	const LoadFn& loadSourceFileFn,
+	const LoadFn& loadBinaryCacheFn,
+	const SaveFn& saveBinaryCacheFn,
+	const std::string& parameterHash)
+{
+	using namespace detail;
+
+	ZoneScoped;
+
+	auto& executor = gApplication.lock()->GetExecutor();
+	auto [import, task] = BeginImportAsset(assetFilePath, loadSourceFileFn, saveBinaryCacheFn, parameterHash);
+
+	if (task)
+		executor.Call(*task);
+
+	// the cache is read the same way as in LoadAssetAsync, and this thread runs other tasks until the read completes
+	auto loadResult = executor.Join(Spawn(executor, LoadAssetCoroutine(import, loadBinaryCacheFn)));
+	ENSURE(loadResult);
+
+	if (!loadResult.value())
+		return std::unexpected(loadResult.value().error());
+
+	return import->manifest->cacheFileInfo;
+}
+
+Future<std::expected<void, std::error_code>> LoadAssetAsync(
+	const std::filesystem::path& assetFilePath,
+	LoadFn loadSourceFileFn,
+	LoadFn loadBinaryCacheFn,
+	SaveFn saveBinaryCacheFn,
+	std::string parameterHash,
+	TaskPriority priority)
+{
+	using namespace detail;
+
+	ZoneScoped;
+
+	auto& executor = gApplication.lock()->GetExecutor();
+	auto [import, task] = BeginImportAsset(assetFilePath, loadSourceFileFn, saveBinaryCacheFn, parameterHash);
+
+	if (task)
+	{
+		SetPriority(*task, priority);
+		executor.Submit({&*task, 1});
 	}
 
-	return LoadBinary<false>(manifest->cacheFileInfo.path, loadBinaryCacheFn);
+	return Spawn(executor, LoadAssetCoroutine(std::move(import), std::move(loadBinaryCacheFn)), priority);
+}
+
+std::expected<Record, std::error_code> CookAsset(
+	const std::filesystem::path& assetFilePath,
+	const LoadFn& loadSourceFileFn,
+	const SaveFn& saveBinaryCacheFn,
+	const std::string& parameterHash)
+{
+	using namespace detail;
+
+	ZoneScoped;
+
+	auto& executor = gApplication.lock()->GetExecutor();
+	auto [import, task] = BeginImportAsset(assetFilePath, loadSourceFileFn, saveBinaryCacheFn, parameterHash);
+
+	if (task)
+		executor.Call(*task);
+	else
+		executor.Join(Future<void>(import->done));
+
+	if (!import->manifest)
+		return std::unexpected(import->manifest.error());
+
+	return import->manifest->cacheFileInfo;
 }
 
 } // namespace file
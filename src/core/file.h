@@ -1,11 +1,15 @@
 #pragma once
 
 #include "utils.h"
+#include "compression.h"
 #include "mio_extra.h"
+#include "task.h"
 
 #include <expected>
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <system_error>
 #include <variant>
@@ -21,19 +25,40 @@ enum class AccessMode : uint8_t
 	kReadWrite
 };
 
+enum class ChecksumMode : uint8_t
+{
+	kNone,
+	kSha256, // sha256 of the whole file, computed serially
+	kSha256Tree, // sha256 merkle root over kChecksumChunkSize chunks, hashed in parallel on the application executor
+	kXxh3128 // xxh3-128 of the whole file. much faster, but not cryptographic. meant for cache validation
+};
+
+// leaf size for ChecksumMode::kSha256Tree. leaves are sha256(0x00 || chunk), inner nodes sha256(0x01 || left || right), odd nodes are promoted as is.
+static constexpr std::size_t kChecksumChunkSize = 1 << 20;
+
+// decoded bytes per independently compressed chunk of an asset cache blob. chunks are decompressed in parallel on the application executor.
+static constexpr std::size_t kCacheChunkSize = 1 << 20;
+
 struct Record
 {
 	std::string path;
 	std::string timeStamp;
-	std::string sha2;
+	std::string checksum; // hex string, empty if computed with ChecksumMode::kNone
 	uint64_t size = 0;
+	int64_t lastWriteTime = 0; // std::filesystem::file_time_type ticks. full resolution, unlike timeStamp
 };
 
+namespace detail
+{
+
+struct ObjectWatch;
+
+} // namespace detail
+
+// Save (and so the destructor, with SaveOnDestruct) skips the write if the serialized object hashes the same as what was last loaded or saved.
 template <typename T, AccessMode Mode, bool SaveOnDestruct = false>
 class Object : public T
 {
-	// todo: implement mechanism to only write changes when contents have changed.
-	// todo: implement mechanism to update contents if an external process has changed the file.
 	// todo: construct or cast directly on mapped memory.
 	// todo: parameter to chose format (binary/json/whatever)
 	// todo: retire this class and remake it as taking a std::span instead of a filename
@@ -55,15 +80,23 @@ public:
 	void Swap(Object& rhs) noexcept;
 	friend void Swap(Object& lhs, Object& rhs) noexcept { lhs.Swap(rhs); }
 
-	void Reload();
+	// returns false if the file is missing, invalid or unchanged
+	[[maybe_unused]] bool Reload();
+
+	// subscribes to changes of the file made by other processes (or other objects). those are not applied behind the
+	// owners back, but picked up by the next ReloadIfChanged, which only touches the file when a change has been seen.
+	void Watch();
+	[[maybe_unused]] bool ReloadIfChanged();
 
 	std::enable_if_t<kMode == AccessMode::kReadWrite, void> Save() const;
 
 private:
 	Record myInfo;
+	mutable std::optional<uint64_t> myContentHash; // xxh3 of the serialized object, as last loaded or saved
+	std::unique_ptr<detail::ObjectWatch> myWatch;
 };
 
-using InputSerializer = zpp::bits::in<mio::basic_mmap_source<std::byte>>;
+using InputSerializer = zpp::bits::in<std::span<const std::byte>>;
 using OutputSerializer = zpp::bits::out<mio_extra::resizeable_mmap_sink<std::byte>, zpp::bits::no_fit_size, zpp::bits::no_enlarge_overflow>;
 
 using LoadFn = std::function<std::error_code(InputSerializer&)>;
@@ -76,13 +109,13 @@ using SaveFn = std::function<std::error_code(OutputSerializer&)>;
 	const char* defaultPathStr,
 	bool createIfMissing = false) noexcept;
 
-template <bool Sha256ChecksumEnable>
+template <ChecksumMode Mode>
 [[nodiscard]] std::expected<Record, std::error_code> GetRecord(const std::filesystem::path& filePath);
 
-template <bool Sha256ChecksumEnable>
+template <ChecksumMode Mode>
 [[nodiscard]] std::expected<Record, std::error_code> LoadBinary(const std::filesystem::path& filePath, const LoadFn& loadOp);
 
-template <bool Sha256ChecksumEnable>
+template <ChecksumMode Mode>
 [[nodiscard]] std::expected<Record, std::error_code> SaveBinary(const std::filesystem::path& filePath, const SaveFn& saveOp);
 
 template <typename T>
@@ -94,6 +127,10 @@ template <typename T>
 template <typename T>
 [[nodiscard]] std::expected<void, std::error_code> SaveObject(const T& object, const std::string& filePath);
 
+// loadSourceFileFn + saveBinaryCacheFn only run when the asset cache needs to be (re)built, after which the data is always
+// handed to the caller through loadBinaryCacheFn. concurrent calls for the same (filePath, parameterHash) share a single import,
+// which runs the callbacks of whichever call started it. the cache is read through the AsyncReader of the application, and the
+// calling thread runs other tasks until it is loaded.
 [[nodiscard]] std::expected<Record, std::error_code> LoadAsset(
 	const std::filesystem::path& filePath,
 	const LoadFn& loadSourceFileFn,
@@ -101,6 +138,24 @@ template <typename T>
 	const SaveFn& SaveBinaryCacheFn,
 	const std::string& parameterHash);
 
+// same as LoadAsset, but the import and cache load run on the executor. whatever the callbacks reference needs to stay alive
+// until the returned future is ready.
+[[nodiscard]] Future<std::expected<void, std::error_code>> LoadAssetAsync(
+	const std::filesystem::path& filePath,
+	LoadFn loadSourceFileFn,
+	LoadFn loadBinaryCacheFn,
+	SaveFn saveBinaryCacheFn,
+	std::string parameterHash,
+	TaskPriority priority = kTaskPriorityNormal);
+
+// brings the asset cache for (filePath, parameterHash) up to date like LoadAsset does, but without loading it.
+// returns the cache file record.
+[[nodiscard]] std::expected<Record, std::error_code> CookAsset(
+	const std::filesystem::path& filePath,
+	const LoadFn& loadSourceFileFn,
+	const SaveFn& saveBinaryCacheFn,
+	const std::string& parameterHash);
+
 } // namespace file
 
 #include "file.inl"
@@ -2,8 +2,11 @@
 #include "profiling.h"
 
 #include <array>
+#include <atomic>
 #include <iostream>
+#include <optional>
 #include <utility>
+#include <vector>
 
 #include <picosha2.h>
 
@@ -27,17 +30,84 @@ const char* ToString(AssetManifestErrorCode code) noexcept;
 
 using AssetManifestError = std::variant<AssetManifestErrorCode, std::error_code>;
 
+// how the data of a cache blob is stored. blobs end with their serialized encoding (followed by its uint32_t size), so that
+// blobs shared between manifests stay self-describing. the manifest keeps a copy, so loads do not need to read the trailer first.
+struct CacheEncoding
+{
+	compression::Codec codec = compression::Codec::kNone;
+	uint32_t chunkSize = 0; // decoded bytes per chunk, the last chunk may be shorter
+	uint64_t size = 0; // decoded size
+	std::vector<uint32_t> chunks; // encoded size of each chunk. chunks that did not compress are stored as is, with their decoded size
+};
+
 struct AssetManifest
 {
 	file::Record assetFileInfo;
 	file::Record cacheFileInfo;
+	CacheEncoding cacheEncoding;
+};
+
+[[nodiscard]] std::string GetChecksum(std::span<const uint8_t> data, ChecksumMode mode);
+[[nodiscard]] uint64_t GetContentHash(std::span<const std::byte> data) noexcept;
+[[nodiscard]] std::expected<void, std::error_code> WriteFile(const std::string& filePath, std::span<const std::byte> data);
+
+[[nodiscard]] std::expected<CacheEncoding, std::error_code> EncodeCacheBlob(const std::filesystem::path& filePath, compression::Codec codec);
+[[nodiscard]] std::expected<CacheEncoding, std::error_code> LoadCacheEncoding(const std::filesystem::path& filePath);
+[[nodiscard]] std::error_code DecodeCacheBlob(std::span<const std::byte> blob, const CacheEncoding& encoding, const LoadFn& loadFn);
+
+struct ObjectWatch
+{
+	ObjectWatch(Watcher& watcher, const std::filesystem::path& filePath);
+	ObjectWatch(const ObjectWatch&) = delete;
+	~ObjectWatch();
+
+	ObjectWatch& operator=(const ObjectWatch&) = delete;
+
+	Watcher& watcher;
+	std::atomic_bool changed = false; // before id, the callback may fire as soon as it is registered
+	Watcher::Id id = 0;
 };
 
 using LoadAssetManifestInfoFn = std::function<std::expected<AssetManifest, std::error_code>(std::span<const std::byte>)>;
 
-template <bool Sha256ChecksumEnable>
+// a file with the same size and last write time as record is assumed to be unchanged, without reading it.
+// otherwise (or always, when paranoid) the checksum is recomputed, so files that were only touched (e.g. by a checkout) still validate.
+// returns the current record of the file, which only differs from record in its time stamps.
+template <ChecksumMode Mode>
+std::optional<Record> ValidateRecord(const Record& record, bool paranoid)
+{
+	ZoneScoped;
+
+	auto fileInfo = GetRecord<ChecksumMode::kNone>(record.path);
+
+	if (!fileInfo || fileInfo->size != record.size)
+		return std::nullopt;
+
+	if (!paranoid && fileInfo->lastWriteTime == record.lastWriteTime)
+	{
+		fileInfo->checksum = record.checksum;
+		return fileInfo;
+	}
+
+	if constexpr (Mode == ChecksumMode::kNone)
+	{
+		return std::nullopt;
+	}
+	else
+	{
+		fileInfo = GetRecord<Mode>(record.path);
+
+		if (!fileInfo || fileInfo->size != record.size || fileInfo->checksum != record.checksum)
+			return std::nullopt;
+
+		return fileInfo;
+	}
+}
+
+// refreshedOut is set if any of the records only had its time stamps changed, in which case the returned manifest should be saved.
+template <ChecksumMode AssetMode, ChecksumMode CacheMode>
 std::expected<AssetManifest, AssetManifestError>
-LoadAssetManifest(std::span<const std::byte> buffer, const LoadAssetManifestInfoFn& loadManifestInfoFn)
+LoadAssetManifest(std::span<const std::byte> buffer, const LoadAssetManifestInfoFn& loadManifestInfoFn, bool paranoid, bool& refreshedOut)
 {
 	ZoneScoped;
 
@@ -46,28 +116,29 @@ LoadAssetManifest(std::span<const std::byte> buffer, const LoadAssetManifestInfo
 	if (!manifestInfo)
 		return std::unexpected(manifestInfo.error());
 
-	auto assetFileInfo = GetRecord<Sha256ChecksumEnable>(manifestInfo->assetFileInfo.path);
+	auto assetFileInfo = ValidateRecord<AssetMode>(manifestInfo->assetFileInfo, paranoid);
 
-	if (!assetFileInfo ||
-		(assetFileInfo->size != manifestInfo->assetFileInfo.size) ||
-		(assetFileInfo->timeStamp.compare(manifestInfo->assetFileInfo.timeStamp)) != 0 ||
-		(Sha256ChecksumEnable ? (assetFileInfo->sha2 != manifestInfo->assetFileInfo.sha2) : false))
+	if (!assetFileInfo)
 		return std::unexpected(AssetManifestErrorCode::kInvalidSourceFile);
 
-	auto cacheFileInfo = GetRecord<Sha256ChecksumEnable>(manifestInfo->cacheFileInfo.path);
+	auto cacheFileInfo = ValidateRecord<CacheMode>(manifestInfo->cacheFileInfo, paranoid);
 
-	if (!cacheFileInfo ||
-		(cacheFileInfo->size != manifestInfo->cacheFileInfo.size) ||
-		(cacheFileInfo->timeStamp.compare(manifestInfo->cacheFileInfo.timeStamp)) != 0 ||
-		(Sha256ChecksumEnable ? (cacheFileInfo->sha2 != manifestInfo->cacheFileInfo.sha2) : false))
+	if (!cacheFileInfo)
 		return std::unexpected(AssetManifestErrorCode::kInvalidCacheFile);
 
-	return manifestInfo.value();
+	refreshedOut =
+		assetFileInfo->lastWriteTime != manifestInfo->assetFileInfo.lastWriteTime ||
+		cacheFileInfo->lastWriteTime != manifestInfo->cacheFileInfo.lastWriteTime;
+
+	return AssetManifest{
+		.assetFileInfo = std::move(*assetFileInfo),
+		.cacheFileInfo = std::move(*cacheFileInfo),
+		.cacheEncoding = std::move(manifestInfo->cacheEncoding)};
 }
 
 } // namespace detail
 
-template <bool Sha256ChecksumEnable>
+template <ChecksumMode Mode>
 std::expected<Record, std::error_code> GetRecord(const std::filesystem::path& filePath)
 {
 	ZoneScoped;
@@ -85,26 +156,32 @@ std::expected<Record, std::error_code> GetRecord(const std::filesystem::path& fi
 	if (!timestamp)
 		return std::unexpected(timestamp.error());
 
+	auto lastWriteTime = std::filesystem::last_write_time(filePath, error);
+	if (error)
+		return std::unexpected(error);
+
+	auto fileSize = std::filesystem::file_size(filePath, error);
+	if (error)
+		return std::unexpected(error);
+
 	auto fileInfo = Record{
-		filePath.string(),
-		timestamp.value(),
-		{},
-		std::filesystem::file_size(filePath)};
+		.path = filePath.string(),
+		.timeStamp = timestamp.value(),
+		.checksum = {},
+		.size = fileSize,
+		.lastWriteTime = static_cast<int64_t>(lastWriteTime.time_since_epoch().count())};
 
-	if constexpr (Sha256ChecksumEnable)
+	if constexpr (Mode != ChecksumMode::kNone)
 	{
-		ZoneScopedN("GetRecord::sha2");
+		ZoneScopedN("GetRecord::checksum");
 
-		static constexpr size_t kSha2Size = 32;
-		std::array<uint8_t, kSha2Size> sha2;
 		mio::basic_mmap_source<uint8_t> file;
 		std::error_code error;
 		file.map(filePath.string(), error);
 		if (error)
 			return std::unexpected(error);
 
-		picosha2::hash256(file.cbegin(), file.cend(), sha2.begin(), sha2.end());
-		picosha2::bytes_to_hex_string(sha2.cbegin(), sha2.cend(), fileInfo.sha2);
+		fileInfo.checksum = detail::GetChecksum(std::span<const uint8_t>(file.data(), file.size()), Mode);
 	}
 
 	return fileInfo;
@@ -166,12 +243,12 @@ std::expected<void, std::error_code> SaveObject(const T& object, const std::stri
 	return {};
 }
 
-template <bool Sha256ChecksumEnable>
+template <ChecksumMode Mode>
 std::expected<Record, std::error_code> LoadBinary(const std::filesystem::path& filePath, const LoadFn& loadOp)
 {
 	ZoneScoped;
 
-	auto fileInfo = GetRecord<Sha256ChecksumEnable>(filePath);
+	auto fileInfo = GetRecord<Mode>(filePath);
 
 	if (fileInfo)
 	{
@@ -181,7 +258,8 @@ std::expected<Record, std::error_code> LoadBinary(const std::filesystem::path& f
 		if (error)
 			return std::unexpected(error);
 
-		auto inStream = zpp::bits::in(file);
+		auto data = std::span<const std::byte>(file.data(), file.size());
+		auto inStream = InputSerializer(data);
 
 		//ASSERT(in.position() == file.size());
 
@@ -192,7 +270,7 @@ std::expected<Record, std::error_code> LoadBinary(const std::filesystem::path& f
 	return fileInfo;
 }
 
-template <bool Sha256ChecksumEnable>
+template <ChecksumMode Mode>
 std::expected<Record, std::error_code> SaveBinary(const std::filesystem::path& filePath, const SaveFn& saveOp)
 {
 	ZoneScoped;
@@ -218,21 +296,25 @@ std::expected<Record, std::error_code> SaveBinary(const std::filesystem::path& f
 			return std::unexpected(error);
 	}
 
-	return GetRecord<Sha256ChecksumEnable>(filePath);
+	return GetRecord<Mode>(filePath);
 }
 
 template <typename T, AccessMode Mode, bool SaveOnDestruct>
 Object<T, Mode, SaveOnDestruct>::Object(
 	const std::filesystem::path& filePath, T&& defaultObject)
-	: T(LoadObject<T>(filePath).value_or(std::forward<T>(defaultObject)))
+	: T(std::forward<T>(defaultObject))
 	, myInfo{filePath.string()}
-{}
+{
+	Reload();
+}
 
 template <typename T, AccessMode Mode, bool SaveOnDestruct>
 Object<T, Mode, SaveOnDestruct>::Object(
 	Object&& other) noexcept
 	: T(std::forward<Object>(other))
 	, myInfo(std::exchange(other.myInfo, {}))
+	, myContentHash(std::exchange(other.myContentHash, std::nullopt))
+	, myWatch(std::exchange(other.myWatch, {}))
 {}
 
 template <typename T, AccessMode Mode, bool SaveOnDestruct>
@@ -248,6 +330,8 @@ Object<T, Mode, SaveOnDestruct>&
 Object<T, Mode, SaveOnDestruct>::operator=(Object&& other) noexcept
 {
 	myInfo = std::exchange(other.myInfo, {});
+	myContentHash = std::exchange(other.myContentHash, std::nullopt);
+	myWatch = std::exchange(other.myWatch, {});
 	return *this;
 }
 
@@ -256,19 +340,81 @@ void Object<T, Mode, SaveOnDestruct>::Swap(Object& rhs) noexcept
 {
 	std::swap<T>(*this, rhs);
 	std::swap(myInfo, rhs.myInfo);
+	std::swap(myContentHash, rhs.myContentHash);
+	std::swap(myWatch, rhs.myWatch);
+}
+
+template <typename T, AccessMode Mode, bool SaveOnDestruct>
+bool Object<T, Mode, SaveOnDestruct>::Reload()
+{
+	ZoneScoped;
+
+	std::error_code error;
+	auto fileStatus = std::filesystem::status(myInfo.path, error);
+
+	if (error || !std::filesystem::is_regular_file(fileStatus))
+		return false;
+
+	auto file = mio::basic_mmap_source<std::byte>();
+	file.map(myInfo.path, error);
+	if (error)
+		return false;
+
+	auto data = std::span<const std::byte>(file.data(), file.size());
+	auto hash = detail::GetContentHash(data);
+
+	// e.g. the echo of our own Save, seen by the watcher
+	if (myContentHash == hash)
+		return false;
+
+	auto object = LoadObject<T>(data);
+	if (!object)
+		return false;
+
+	static_cast<T&>(*this) = std::move(object.value());
+	myContentHash = hash;
+
+	return true;
+}
+
+template <typename T, AccessMode Mode, bool SaveOnDestruct>
+void Object<T, Mode, SaveOnDestruct>::Watch()
+{
+	ENSUREF(!myInfo.path.empty(), "Object has no file to watch!");
+
+	if (!myWatch)
+		myWatch = std::make_unique<detail::ObjectWatch>(gApplication.lock()->GetFileWatcher(), myInfo.path);
 }
 
 template <typename T, AccessMode Mode, bool SaveOnDestruct>
-void Object<T, Mode, SaveOnDestruct>::Reload()
+bool Object<T, Mode, SaveOnDestruct>::ReloadIfChanged()
 {
-	static_cast<T&>(*this) = LoadObject<T>(myInfo.path).value_or(std::move(static_cast<T&>(*this)));
+	if (!myWatch || !myWatch->changed.exchange(false, std::memory_order_acquire))
+		return false;
+
+	return Reload();
 }
 
 template <typename T, AccessMode Mode, bool SaveOnDestruct>
 std::enable_if_t<Object<T, Mode, SaveOnDestruct>::kMode == AccessMode::kReadWrite, void> Object<T, Mode, SaveOnDestruct>::Save() const
 {
-	auto result = SaveObject(static_cast<const T&>(*this), myInfo.path);
-	ASSERT(result);
+	ZoneScoped;
+
+	std::vector<std::byte> buffer;
+	auto outStream = zpp::bits::out(buffer);
+
+	auto result = outStream(static_cast<const T&>(*this));
+	ASSERT(!failure(result));
+
+	auto hash = detail::GetContentHash(buffer);
+
+	if (myContentHash == hash)
+		return;
+
+	auto writeResult = detail::WriteFile(myInfo.path, buffer);
+	ASSERT(writeResult);
+
+	myContentHash = hash;
 }
 
 } // namespace file
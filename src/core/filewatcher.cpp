@@ -0,0 +1,144 @@
+#include "filewatcher.h"
+#include "assert.h"//NOLINT(modernize-deprecated-headers)
+#include "profiling.h"
+
+#include <array>
+
+#if defined(__linux__)
+#	include <poll.h>
+#	include <sys/eventfd.h>
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#endif
+
+namespace file
+{
+
+Watcher::Watcher()
+{
+#if defined(__linux__)
+	myFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (myFd < 0)
+		return;
+
+	myWakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	ENSUREF(myWakeFd >= 0, "Failed to create eventfd: {}", std::error_code(errno, std::system_category()).message());
+
+	myThread = std::thread(&Watcher::InternalRun, this);
+#endif
+}
+
+Watcher::~Watcher()
+{
+#if defined(__linux__)
+	if (myFd < 0)
+		return;
+
+	uint64_t wake = 1;
+	[[maybe_unused]] auto written = ::write(myWakeFd, &wake, sizeof(wake));
+
+	myThread.join();
+
+	::close(myWakeFd);
+	::close(myFd);
+#endif
+}
+
+Watcher::Id Watcher::Add(const std::filesystem::path& filePath, Callback&& callback)
+{
+#if defined(__linux__)
+	if (myFd < 0)
+		return 0;
+
+	auto absolutePath = std::filesystem::absolute(filePath).lexically_normal();
+	auto directory = absolutePath.parent_path();
+
+	std::unique_lock lock(myMutex);
+
+	// watches are per inode, so adding the same directory twice returns the same descriptor
+	int wd = ::inotify_add_watch(myFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (wd < 0)
+		return 0;
+
+	myWatchRefCounts[wd]++;
+
+	auto id = myNextId++;
+	myEntries.emplace(id, Entry{.wd = wd, .fileName = absolutePath.filename().string(), .callback = std::move(callback)});
+
+	return id;
+#else
+	(void)filePath;
+	(void)callback;
+	return 0;
+#endif
+}
+
+void Watcher::Remove(Id id)
+{
+#if defined(__linux__)
+	std::unique_lock lock(myMutex);
+
+	auto it = myEntries.find(id);
+	if (it == myEntries.end())
+		return;
+
+	auto wd = it->second.wd;
+	myEntries.erase(it);
+
+	if (auto refIt = myWatchRefCounts.find(wd); refIt != myWatchRefCounts.end() && --refIt->second == 0)
+	{
+		::inotify_rm_watch(myFd, wd);
+		myWatchRefCounts.erase(refIt);
+	}
+#else
+	(void)id;
+#endif
+}
+
+void Watcher::InternalRun()
+{
+#if defined(__linux__)
+	alignas(inotify_event) std::array<char, 4096> buffer;
+
+	for (;;)
+	{
+		std::array<pollfd, 2> fds{{{.fd = myFd, .events = POLLIN, .revents = 0}, {.fd = myWakeFd, .events = POLLIN, .revents = 0}}};
+
+		if (::poll(fds.data(), fds.size(), -1) < 0)
+		{
+			ENSUREF(errno == EINTR, "poll failed: {}", std::error_code(errno, std::system_category()).message());
+			continue;
+		}
+
+		if ((fds[1].revents & POLLIN) != 0)
+			break;
+
+		if ((fds[0].revents & POLLIN) == 0)
+			continue;
+
+		ZoneScopedN("Watcher::InternalRun");
+
+		for (auto length = ::read(myFd, buffer.data(), buffer.size()); length > 0; length = ::read(myFd, buffer.data(), buffer.size()))
+		{
+			std::unique_lock lock(myMutex);
+
+			for (auto offset = 0L; offset < length;)
+			{
+				const auto* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+				offset += static_cast<long>(sizeof(inotify_event) + event->len);
+
+				if (event->len == 0)
+					continue;
+
+				std::string_view fileName(event->name);
+
+				for (auto& [id, entry] : myEntries)
+					if (entry.wd == event->wd && entry.fileName == fileName)
+						entry.callback();
+			}
+		}
+	}
+#endif
+}
+
+} // namespace file
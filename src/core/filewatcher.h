@@ -0,0 +1,60 @@
+#pragma once
+
+#include "utils.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace file
+{
+
+// notifies about files being rewritten, by this or any other process. on linux this is an inotify watch on the parent directory
+// (so that files replaced by a rename, like most editors do, are caught too), drained by a thread blocking on the inotify descriptor.
+// elsewhere Add is a no-op.
+class Watcher
+{
+public:
+	using Id = uint32_t;
+	using Callback = std::function<void()>;
+
+	Watcher();
+	Watcher(const Watcher&) = delete;
+	Watcher(Watcher&&) noexcept = delete;
+	~Watcher();
+
+	Watcher& operator=(const Watcher&) = delete;
+	Watcher& operator=(Watcher&&) noexcept = delete;
+
+	// callback runs on the watcher thread, with the watcher locked. keep it short, and do not call Add or Remove from it.
+	// returns 0 if filePath can not be watched.
+	[[nodiscard]] Id Add(const std::filesystem::path& filePath, Callback&& callback);
+
+	// once Remove returns, the callback is not running and will not be called again
+	void Remove(Id id);
+
+	[[nodiscard]] bool Valid() const noexcept { return myFd >= 0; }
+
+private:
+	struct Entry
+	{
+		int wd = -1;
+		std::string fileName;
+		Callback callback;
+	};
+
+	void InternalRun();
+
+	int myFd = -1;
+	int myWakeFd = -1;
+	std::mutex myMutex;
+	UnorderedMap<int, uint32_t> myWatchRefCounts; // inotify watch descriptor -> entry count. protected by myMutex
+	UnorderedMap<Id, Entry> myEntries; // protected by myMutex
+	Id myNextId = 1; // protected by myMutex
+	std::thread myThread;
+};
+
+} // namespace file
@@ -1,36 +1,48 @@
 #include "assert.h"//NOLINT(modernize-deprecated-headers)
 
 template <typename T>
-Future<T>::Future(std::shared_ptr<FutureState>&& state) noexcept
-//	: myState(std::forward<std::shared_ptr<FutureState>>(state))
-{
-	std::atomic_store(&InternalState(), std::forward<std::shared_ptr<FutureState>>(state));
-}
+Future<T>::Future(TaskHandle handle, uint16_t generation) noexcept
+	: myHandle(handle)
+	, myGeneration(generation)
+{}
 
 template <typename T>
 Future<T>::Future(Future&& other) noexcept
-//	: myState(std::exchange(other.InternalState(), {}))
+	: myHandle(std::exchange(other.myHandle, {}))
+	, myGeneration(std::exchange(other.myGeneration, 0))
+{}
+
+template <typename T>
+Future<T>::Future(const Future& other) noexcept
+	: myHandle(other.myHandle)
+	, myGeneration(other.myGeneration)
 {
-	std::atomic_exchange(&InternalState(), std::atomic_load(&other.InternalState()));
+	if (Valid())
+		core::detail::InternalRetain(myHandle);
 }
 
 template <typename T>
-Future<T>::Future(const Future& other) noexcept
-//	: myState(other.InternalState())
+Future<T>::~Future() noexcept
 {
-	std::atomic_store(&InternalState(), std::atomic_load(&other.InternalState()));
+	InternalRelease();
 }
 
 template <typename T>
 bool Future<T>::operator==(const Future& other) const noexcept
 {
-	return std::atomic_load(&InternalState()) == std::atomic_load(&other.InternalState());
+	return myHandle == other.myHandle && myGeneration == other.myGeneration;
 }
 
 template <typename T>
 Future<T>& Future<T>::operator=(Future&& other) noexcept
 {
-	std::atomic_exchange(&InternalState(), std::atomic_load(&other.InternalState()));
+	if (this != &other)
+	{
+		InternalRelease();
+
+		myHandle = std::exchange(other.myHandle, {});
+		myGeneration = std::exchange(other.myGeneration, 0);
+	}
 
 	return *this;
 }
@@ -39,7 +51,15 @@ template <typename T>
 Future<T>& Future<T>::operator=(const Future& other) noexcept
 {
 	if (this != &other)
-		std::atomic_store(&InternalState(), std::atomic_load(&other.InternalState()));
+	{
+		if (other.Valid())
+			core::detail::InternalRetain(other.myHandle);
+
+		InternalRelease();
+
+		myHandle = other.myHandle;
+		myGeneration = other.myGeneration;
+	}
 
 	return *this;
 }
@@ -49,13 +69,11 @@ typename Future<T>::value_t Future<T>::Get()
 {
 	Wait();
 
-	// important copy! otherwise value will be garbage on exit due to myState.reset().
-	auto state = std::atomic_load(&InternalState());
-	auto retval = state->value;
+	auto& state = InternalState();
+	if (state.exception)
+		std::rethrow_exception(state.exception);
 
-	state.reset();
-
-	return retval;
+	return state.template Value<value_t>();
 }
 
 template <typename T>
@@ -63,15 +81,21 @@ bool Future<T>::IsReady() const noexcept
 {
 	ENSUREF(Valid(), "Future is not valid!");
 
-	auto& state = *std::atomic_load(&InternalState());
+	return std::atomic_ref(InternalState().latch).load(std::memory_order_acquire) == 0;
+}
+
+template <typename T>
+bool Future<T>::IsCancelled() const noexcept
+{
+	ENSUREF(Valid(), "Future is not valid!");
 
-	return std::atomic_ref(state.latch).load(std::memory_order_relaxed) == 0;
+	return std::atomic_ref(InternalState().cancelled).load(std::memory_order_relaxed) != 0;
 }
 
 template <typename T>
 bool Future<T>::Valid() const noexcept
 {
-	return !!std::atomic_load(&InternalState());
+	return !!myHandle;
 }
 
 template <typename T>
@@ -79,9 +103,47 @@ void Future<T>::Wait() const
 {
 	ENSUREF(Valid(), "Future is not valid!");
 
-	auto& state = *std::atomic_load(&InternalState());
-
-	auto latch = std::atomic_ref(state.latch);
-	while (auto current = latch.load(std::memory_order_relaxed))
+	auto latch = std::atomic_ref(InternalState().latch);
+	while (auto current = latch.load(std::memory_order_acquire))
 		latch.wait(current, std::memory_order_acquire);
 }
+
+template <typename T>
+typename Future<T>::Awaiter Future<T>::operator co_await() const noexcept
+{
+	ENSUREF(Valid(), "Future is not valid!");
+
+	return {.future = *this};
+}
+
+template <typename T>
+template <typename Promise>
+bool Future<T>::Awaiter::await_suspend(std::coroutine_handle<Promise> continuation) noexcept
+{
+	node.continuation = continuation;
+
+	if constexpr (requires { { continuation.promise().priority } -> std::convertible_to<TaskPriority>; })
+		node.priority = continuation.promise().priority;
+
+	// if the task finished after await_ready we resume right away
+	return core::detail::InternalTryAwait(future.myHandle, node);
+}
+
+template <typename T>
+TaskState& Future<T>::InternalState() const noexcept
+{
+	// the slot can not be recycled while we hold a reference, so a generation mismatch means a stale/corrupt handle.
+	ENSUREF(core::detail::InternalGeneration(myHandle) == myGeneration, "Future refers to a recycled task slot!");
+
+	return *core::detail::InternalHandleToState(myHandle);
+}
+
+template <typename T>
+void Future<T>::InternalRelease() noexcept
+{
+	if (!Valid())
+		return;
+
+	core::detail::InternalRelease(std::exchange(myHandle, {}));
+	myGeneration = 0;
+}
@@ -6,45 +6,109 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <variant>
+#include <vector>
 
-template <typename T, std::size_t N>
+enum class MemoryPoolMode : uint8_t
+{
+	kLockFree, // free indices are kept in a tagged-index Treiber stack. allocation order is unspecified.
+	kOrdered // free indices are kept in a min-heap under a lock. always returns the lowest free index.
+};
+
+// Pool of T:s addressed by compact indices. Storage is allocated in segments of SegmentSize elements,
+// which are never moved or freed until the pool is destroyed, so pointers to allocated elements stay stable while the pool grows.
+// MaxCapacity is the upper bound of the pool and determines the size of the handle type.
+// In kLockFree mode, every segment belongs to a (NUMA) node and each node has its own free list. Allocations are served
+// from the requested node's segments first, and freed entries always return to the node that owns their segment.
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode = MemoryPoolMode::kLockFree, std::size_t SegmentSize = 1024>
 class MemoryPool final
 {
-	using Handle = MinSizeIndex<N>;
+	using Handle = MinSizeIndex<MaxCapacity>;
+
+	static_assert(std::has_single_bit(SegmentSize));
+	static_assert(MaxCapacity < std::numeric_limits<uint32_t>::max());
+	static constexpr std::size_t kMaxSegmentCount = (MaxCapacity + SegmentSize - 1) / SegmentSize;
 
 public:
-	constexpr MemoryPool() noexcept;
+	static constexpr std::size_t kMaxNodeCount = 8; // higher node indices wrap around
+
+	constexpr MemoryPool() noexcept = default;
 	MemoryPool(const MemoryPool&) = delete;
 	MemoryPool(MemoryPool&&) noexcept = delete;
+	~MemoryPool() noexcept;
 
 	MemoryPool& operator=(const MemoryPool&) = delete;
 	MemoryPool& operator=(MemoryPool&&) noexcept = delete;
 
-	[[nodiscard]] Handle Allocate() noexcept;
+	[[nodiscard]] Handle Allocate(uint32_t node = 0) noexcept;
 	void Free(Handle handle) noexcept;
+
+	// grows the pool (in whole segments owned by node) until it can hold at least capacity elements. never shrinks.
+	void Reserve(std::size_t capacity, uint32_t node = 0) noexcept;
 	
-	// never store the returned pointer, it may become invalid if the pool is resized
-	[[nodiscard]] constexpr T* GetPointer(Handle handle) noexcept;
-	[[nodiscard]] constexpr Handle GetHandle(const T* ptr) noexcept;
+	[[nodiscard]] T* GetPointer(Handle handle) const noexcept;
+	[[nodiscard]] Handle GetHandle(const T* ptr) const noexcept;
 
-	[[nodiscard]] constexpr auto Size() const noexcept { return Capacity() - myAvailable; }
-	[[nodiscard]] static consteval auto Capacity() noexcept { return N; }
+	[[nodiscard]] std::size_t Size() const noexcept { return mySize.load(std::memory_order_relaxed); }
+	[[nodiscard]] std::size_t Capacity() const noexcept { return myCapacity.load(std::memory_order_relaxed); }
+	[[nodiscard]] std::size_t HighWaterMark() const noexcept { return myHighWaterMark.load(std::memory_order_relaxed); }
+	[[nodiscard]] static consteval auto MaxSize() noexcept { return MaxCapacity; }
+	[[nodiscard]] static consteval auto GetMode() noexcept { return Mode; }
 
 private:
 	struct Entry
 	{
-		static constexpr std::size_t kMaxIndex{N - 1};
+		static constexpr std::size_t kMaxIndex{MaxCapacity - 1};
 		std_extra::min_unsigned_t<kMaxIndex> index;
 
 		// we want lower indexes to be at the top of the heap
 		[[nodiscard]] bool operator<(const Entry& other) const noexcept { return index >= other.index; }
 	};
 
-	alignas(T) std::array<std::byte, N * sizeof(T)> myPool;
-	std::array<Entry, N> myEntries;
-	UpgradableSharedMutex myMutex;
-	std_extra::min_unsigned_t<N> myAvailable{0};
+	using NextIndices = std::conditional_t<
+		Mode == MemoryPoolMode::kLockFree,
+		std::array<std::atomic<uint32_t>, SegmentSize>,
+		std::monostate>;
+
+	struct Segment
+	{
+		alignas(T) std::array<std::byte, SegmentSize * sizeof(T)> storage;
+		[[no_unique_address]] NextIndices next;
+	};
+
+	// free list head is packed as [tag:32|index:32]. the tag is bumped on every update to avoid ABA problems.
+	static constexpr uint32_t kEndOfList = std::numeric_limits<uint32_t>::max();
+	[[nodiscard]] static constexpr uint64_t InternalPack(uint32_t index, uint32_t tag) noexcept { return (static_cast<uint64_t>(tag) << 32U) | index; }
+	[[nodiscard]] static constexpr uint32_t InternalIndex(uint64_t head) noexcept { return static_cast<uint32_t>(head); }
+	[[nodiscard]] static constexpr uint32_t InternalTag(uint64_t head) noexcept { return static_cast<uint32_t>(head >> 32U); }
+	[[nodiscard]] std::atomic<uint32_t>& InternalNext(uint32_t index) const noexcept;
+
+	[[nodiscard]] bool InternalGrow(uint32_t node) noexcept;
+	[[nodiscard]] Handle InternalAllocateOrdered() noexcept;
+	[[nodiscard]] bool InternalTryPopLockFree(uint32_t node, Handle& handle) noexcept;
+	[[nodiscard]] Handle InternalAllocateLockFree(uint32_t node) noexcept;
+	void InternalFreeOrdered(Handle handle) noexcept;
+	void InternalFreeLockFree(uint32_t first, uint32_t last) noexcept;
+
+	struct alignas(std_extra::hardware_destructive_interference_size) FreeHead
+	{
+		std::atomic<uint64_t> head{InternalPack(kEndOfList, 0)};
+	};
+
+	std::array<std::atomic<Segment*>, kMaxSegmentCount> mySegments{};
+	std::array<uint8_t, kMaxSegmentCount> mySegmentNodes{}; // written before the segment is published
+	UpgradableSharedMutex myMutex; // kOrdered: protects myEntries & myAvailable. kLockFree: only taken when growing.
+	std::vector<Entry> myEntries;
+	std::size_t myAvailable{0};
+	std::array<FreeHead, kMaxNodeCount> myFreeHeads{};
+	alignas(std_extra::hardware_destructive_interference_size) std::atomic<std::size_t> mySize{0};
+	std::atomic<std::size_t> myHighWaterMark{0};
+	std::atomic<std::size_t> myCapacity{0};
 };
 
 #include "memorypool.inl"
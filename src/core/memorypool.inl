@@ -1,31 +1,101 @@
 #include "assert.h"//NOLINT(modernize-deprecated-headers)
 
+#include <new>
 #include <shared_mutex>
 
-template <typename T, std::size_t N>
-constexpr MemoryPool<T, N>::MemoryPool() noexcept
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+MemoryPool<T, MaxCapacity, Mode, SegmentSize>::~MemoryPool() noexcept
 {
-	static_assert(Capacity() > 0);
+	for (auto& segment : mySegments)
+		delete segment.load(std::memory_order_relaxed);
+}
+
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+std::atomic<uint32_t>& MemoryPool<T, MaxCapacity, Mode, SegmentSize>::InternalNext(uint32_t index) const noexcept
+{
+	static_assert(Mode == MemoryPoolMode::kLockFree);
 
-	for (auto& entry : myEntries)
-		entry.index = myAvailable++;
+	auto* segment = mySegments[index / SegmentSize].load(std::memory_order_acquire);
 
-	ENSURE(myAvailable == Capacity());
+	ENSURE(segment != nullptr);
 
-	std::make_heap(myEntries.begin(), myEntries.end());
+	return segment->next[index % SegmentSize];
 }
 
-template <typename T, std::size_t N>
-MemoryPool<T, N>::Handle MemoryPool<T, N>::Allocate() noexcept
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+bool MemoryPool<T, MaxCapacity, Mode, SegmentSize>::InternalGrow(uint32_t node) noexcept
+{
+	// needs to be called with myMutex exclusively locked
+
+	auto capacity = myCapacity.load(std::memory_order_relaxed);
+
+	if (capacity >= MaxCapacity)
+		return false;
+
+	auto segmentIndex = capacity / SegmentSize;
+	auto segmentCapacity = std::min(SegmentSize, MaxCapacity - capacity);
+
+	ENSURE(segmentIndex < kMaxSegmentCount);
+	ENSURE(mySegments[segmentIndex].load(std::memory_order_relaxed) == nullptr);
+
+	auto* segment = new (std::nothrow) Segment;
+
+	if (segment == nullptr)
+		return false;
+
+	mySegmentNodes[segmentIndex] = static_cast<uint8_t>(node % kMaxNodeCount);
+
+	// published with release semantics since GetPointer does not take the lock
+	mySegments[segmentIndex].store(segment, std::memory_order_release);
+	myCapacity.store(capacity + segmentCapacity, std::memory_order_release);
+
+	auto first = static_cast<uint32_t>(capacity);
+	auto last = static_cast<uint32_t>(capacity + segmentCapacity - 1);
+
+	if constexpr (Mode == MemoryPoolMode::kLockFree)
+	{
+		for (auto index = first; index < last; index++)
+			segment->next[index % SegmentSize].store(index + 1, std::memory_order_relaxed);
+
+		InternalFreeLockFree(first, last);
+	}
+	else
+	{
+		// new (higher) indices are added to the bottom of the heap
+		myEntries.resize(capacity + segmentCapacity);
+		for (auto index = first; index <= last; index++)
+		{
+			myEntries[myAvailable++].index = index;
+			std::push_heap(myEntries.begin(), myEntries.begin() + myAvailable);
+		}
+
+		ENSURE(std::is_heap(myEntries.begin(), myEntries.begin() + myAvailable));
+	}
+
+	return true;
+}
+
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+void MemoryPool<T, MaxCapacity, Mode, SegmentSize>::Reserve(std::size_t capacity, uint32_t node) noexcept
 {
 	std::unique_lock lock(myMutex);
 
-	ENSURE(myAvailable > 0);
-	ENSURE(myAvailable <= Capacity());
+	ENSUREF(capacity <= MaxCapacity, "Requested capacity exceeds the maximum capacity of the pool!");
 
-	if (myAvailable == 0 || myAvailable > Capacity())
+	while (myCapacity.load(std::memory_order_relaxed) < capacity)
+		ENSURE(InternalGrow(node));
+}
+
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+MemoryPool<T, MaxCapacity, Mode, SegmentSize>::Handle MemoryPool<T, MaxCapacity, Mode, SegmentSize>::InternalAllocateOrdered() noexcept
+{
+	std::unique_lock lock(myMutex);
+
+	if (myAvailable == 0 && !InternalGrow(0))
 		return Handle{};
 
+	ENSURE(myAvailable > 0);
+
 	Handle handle{myEntries[0].index};
 
 	std::pop_heap(myEntries.begin(), myEntries.begin() + myAvailable);
@@ -37,13 +107,86 @@ MemoryPool<T, N>::Handle MemoryPool<T, N>::Allocate() noexcept
 	return handle;
 }
 
-template <typename T, std::size_t N>
-void MemoryPool<T, N>::Free(Handle handle) noexcept
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+bool MemoryPool<T, MaxCapacity, Mode, SegmentSize>::InternalTryPopLockFree(uint32_t node, Handle& handle) noexcept
+{
+	auto& freeHead = myFreeHeads[node].head;
+	auto head = freeHead.load(std::memory_order_acquire);
+
+	while (true)
+	{
+		auto index = InternalIndex(head);
+
+		if (index == kEndOfList)
+			return false;
+
+		// next may be stale if another thread pops index before us, but then the tag will have changed and the CAS fails.
+		auto next = InternalNext(index).load(std::memory_order_relaxed);
+
+		if (freeHead.compare_exchange_weak(
+				head, InternalPack(next, InternalTag(head) + 1), std::memory_order_acquire, std::memory_order_acquire))
+		{
+			handle = Handle{static_cast<std_extra::min_unsigned_t<MaxCapacity>>(index)};
+			return true;
+		}
+	}
+}
+
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+MemoryPool<T, MaxCapacity, Mode, SegmentSize>::Handle MemoryPool<T, MaxCapacity, Mode, SegmentSize>::InternalAllocateLockFree(uint32_t node) noexcept
+{
+	node %= kMaxNodeCount;
+
+	Handle handle;
+
+	while (!InternalTryPopLockFree(node, handle))
+	{
+		std::unique_lock lock(myMutex);
+
+		// someone else may have grown the pool or freed entries while we were waiting for the lock
+		if (InternalIndex(myFreeHeads[node].head.load(std::memory_order_acquire)) != kEndOfList)
+			continue;
+
+		if (!InternalGrow(node))
+		{
+			// the pool is at its maximum capacity, so borrow from the other nodes
+			for (uint32_t nodeIt = 1; nodeIt < kMaxNodeCount; nodeIt++)
+				if (InternalTryPopLockFree((node + nodeIt) % kMaxNodeCount, handle))
+					return handle;
+
+			return Handle{};
+		}
+	}
+
+	return handle;
+}
+
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+MemoryPool<T, MaxCapacity, Mode, SegmentSize>::Handle MemoryPool<T, MaxCapacity, Mode, SegmentSize>::Allocate(uint32_t node) noexcept
+{
+	Handle handle;
+
+	if constexpr (Mode == MemoryPoolMode::kLockFree)
+		handle = InternalAllocateLockFree(node);
+	else
+		handle = InternalAllocateOrdered();
+
+	if (!handle)
+		return handle;
+
+	auto size = mySize.fetch_add(1, std::memory_order_relaxed) + 1;
+	auto highWaterMark = myHighWaterMark.load(std::memory_order_relaxed);
+	while (size > highWaterMark && !myHighWaterMark.compare_exchange_weak(highWaterMark, size, std::memory_order_relaxed));
+
+	return handle;
+}
+
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+void MemoryPool<T, MaxCapacity, Mode, SegmentSize>::InternalFreeOrdered(Handle handle) noexcept
 {
 	std::unique_lock lock(myMutex);
 
-	ENSURE(!!handle);
-	ENSURE(myAvailable < Capacity());
+	ENSURE(myAvailable < myCapacity.load(std::memory_order_relaxed));
 
 	myEntries[myAvailable].index = handle.value;
 
@@ -54,18 +197,65 @@ void MemoryPool<T, N>::Free(Handle handle) noexcept
 	ENSURE(std::is_heap(myEntries.begin(), myEntries.begin() + myAvailable));
 }
 
-template <typename T, std::size_t N>
-constexpr T* MemoryPool<T, N>::GetPointer(Handle handle) noexcept
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+void MemoryPool<T, MaxCapacity, Mode, SegmentSize>::InternalFreeLockFree(uint32_t first, uint32_t last) noexcept
+{
+	// pushes the chain first -> ... -> last onto the free list of the node owning the segment (chains never span segments)
+	auto& freeHead = myFreeHeads[mySegmentNodes[first / SegmentSize]].head;
+	auto& lastNext = InternalNext(last);
+	auto head = freeHead.load(std::memory_order_relaxed);
+
+	do
+	{
+		lastNext.store(InternalIndex(head), std::memory_order_relaxed);
+	} while (!freeHead.compare_exchange_weak(
+		head, InternalPack(first, InternalTag(head) + 1), std::memory_order_release, std::memory_order_relaxed));
+}
+
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+void MemoryPool<T, MaxCapacity, Mode, SegmentSize>::Free(Handle handle) noexcept
 {
 	ENSURE(!!handle);
+	ENSURE(handle.value < Capacity());
 
-	return reinterpret_cast<T*>(&myPool[handle.value * sizeof(T)]);
+	if constexpr (Mode == MemoryPoolMode::kLockFree)
+		InternalFreeLockFree(handle.value, handle.value);
+	else
+		InternalFreeOrdered(handle);
+
+	mySize.fetch_sub(1, std::memory_order_relaxed);
 }
 
-template <typename T, std::size_t N>
-constexpr MemoryPool<T, N>::Handle MemoryPool<T, N>::GetHandle(const T* ptr) noexcept
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+T* MemoryPool<T, MaxCapacity, Mode, SegmentSize>::GetPointer(Handle handle) const noexcept
+{
+	ENSURE(!!handle);
+
+	auto* segment = mySegments[handle.value / SegmentSize].load(std::memory_order_acquire);
+
+	ENSURE(segment != nullptr);
+
+	return reinterpret_cast<T*>(&segment->storage[(handle.value % SegmentSize) * sizeof(T)]);
+}
+
+template <typename T, std::size_t MaxCapacity, MemoryPoolMode Mode, std::size_t SegmentSize>
+MemoryPool<T, MaxCapacity, Mode, SegmentSize>::Handle MemoryPool<T, MaxCapacity, Mode, SegmentSize>::GetHandle(const T* ptr) const noexcept
 {
 	ENSURE(ptr != nullptr);
 
-	return Handle{static_cast<std_extra::min_unsigned_t<N>>(ptr - reinterpret_cast<const T*>(myPool.data()))};
+	const auto* bytePtr = reinterpret_cast<const std::byte*>(ptr);
+
+	for (std::size_t segmentIt = 0; segmentIt < kMaxSegmentCount; segmentIt++)
+	{
+		const auto* segment = mySegments[segmentIt].load(std::memory_order_acquire);
+
+		if (segment == nullptr)
+			break;
+
+		if (const auto* storage = segment->storage.data(); bytePtr >= storage && bytePtr < storage + segment->storage.size())
+			return Handle{static_cast<std_extra::min_unsigned_t<MaxCapacity>>(
+				segmentIt * SegmentSize + static_cast<std::size_t>(bytePtr - storage) / sizeof(T))};
+	}
+
+	return Handle{};
 }
@@ -6,49 +6,206 @@ namespace core
 namespace detail
 {
 
-static MemoryPool<Task, kTaskPoolSize> gTaskPool;
+// the task is constructed/destroyed by the executor, while the state is owned by the slot reference count.
+struct TaskSlot
+{
+	alignas(Task) std::array<std::byte, sizeof(Task)> task;
+	TaskState state;
+};
+static_assert(offsetof(TaskSlot, task) == 0);
 
-Task* InternalHandleToPtr(TaskHandle handle) noexcept
+static MemoryPool<TaskSlot, kTaskPoolMaxSize> gTaskPool;
+static std::array<uint16_t, kTaskPoolMaxSize> gTaskGenerations{}; // bumped every time a slot is returned to the pool
+static thread_local uint32_t tlTaskAllocationNode = 0;
+static thread_local TaskTraceParent tlTaskTraceParent{};
+static MemoryPool<TaskAdjacencyChunk, kTaskAdjacencyChunkPoolMaxSize> gTaskAdjacencyChunkPool;
+
+static TaskSlot* InternalHandleToSlot(TaskHandle handle) noexcept
 {
 	ENSURE(!!handle);
-	ENSURE(handle.value < kTaskPoolSize);
+	ENSURE(handle.value < gTaskPool.Capacity());
 	
-	Task* ptr = gTaskPool.GetPointer(handle);
+	TaskSlot* slot = gTaskPool.GetPointer(handle);
 
-	ENSURE(ptr != nullptr);
+	ENSURE(slot != nullptr);
 	
-	return ptr;
+	return slot;
+}
+
+Task* InternalHandleToPtr(TaskHandle handle) noexcept
+{
+	return std::launder(reinterpret_cast<Task*>(InternalHandleToSlot(handle)->task.data()));
+}
+
+TaskState* InternalHandleToState(TaskHandle handle) noexcept
+{
+	return &InternalHandleToSlot(handle)->state;
 }
 
 TaskHandle InternalPtrToHandle(Task* ptr) noexcept
 {
 	ENSURE(ptr != nullptr);
 
-	auto handle = gTaskPool.GetHandle(ptr);
+	auto handle = gTaskPool.GetHandle(reinterpret_cast<TaskSlot*>(ptr));
 
 	ENSURE(!!handle);
-	ENSURE(handle.value < kTaskPoolSize);
+	ENSURE(handle.value < gTaskPool.Capacity());
 
 	return handle;
 }
 
 TaskHandle InternalAllocate() noexcept
 {
-	TaskHandle handle = gTaskPool.Allocate();
+	TaskHandle handle = gTaskPool.Allocate(tlTaskAllocationNode);
 
 	ENSURE(!!handle);
 
+	auto& state = *std::construct_at(&gTaskPool.GetPointer(handle)->state);
+
+	// splitmix64 of (parent, creation order)
+	uint64_t traceId = tlTaskTraceParent.id + (++tlTaskTraceParent.childCount * 0x9e3779b97f4a7c15ULL);
+	traceId = (traceId ^ (traceId >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+	traceId = (traceId ^ (traceId >> 27U)) * 0x94d049bb133111ebULL;
+	state.traceId = traceId ^ (traceId >> 31U);
+
 	return handle;
 }
 
-void InternalFree(TaskHandle handle) noexcept
+void InternalRetain(TaskHandle handle) noexcept
 {
-	ENSURE(!!handle);
-	ENSURE(handle.value < kTaskPoolSize);
+	auto& state = *InternalHandleToState(handle);
+
+	[[maybe_unused]] auto refCount = std::atomic_ref(state.refCount).fetch_add(1, std::memory_order_relaxed);
+
+	ASSERT(refCount > 0);
+}
+
+void InternalRelease(TaskHandle handle) noexcept
+{
+	auto& state = *InternalHandleToState(handle);
+
+	auto refCount = std::atomic_ref(state.refCount).fetch_sub(1, std::memory_order_acq_rel);
+
+	ASSERT(refCount > 0);
+
+	if (refCount != 1)
+		return;
+
+	if (state.valueDeleteFcn)
+		state.valueDeleteFcn(state.value.data());
+
+	InternalFreeAdjacencies(state);
+
+	std::destroy_at(&state);
+
+	std::atomic_ref(gTaskGenerations[handle.value]).fetch_add(1, std::memory_order_relaxed);
 
 	gTaskPool.Free(handle);
 }
 
+uint16_t InternalGeneration(TaskHandle handle) noexcept
+{
+	ENSURE(!!handle);
+	ENSURE(handle.value < gTaskPool.Capacity());
+
+	return std::atomic_ref(gTaskGenerations[handle.value]).load(std::memory_order_relaxed);
+}
+
+bool InternalTryAwait(TaskHandle handle, TaskAwaiter& awaiter) noexcept
+{
+	auto awaiters = std::atomic_ref(InternalHandleToState(handle)->awaiters);
+	auto head = awaiters.load(std::memory_order_acquire);
+
+	do
+	{
+		if (head == TaskState::kAwaitersClosed)
+			return false;
+
+		awaiter.next = reinterpret_cast<TaskAwaiter*>(head);//NOLINT(performance-no-int-to-ptr)
+	} while (!awaiters.compare_exchange_weak(
+		head, reinterpret_cast<uintptr_t>(&awaiter), std::memory_order_acq_rel, std::memory_order_acquire));
+
+	return true;
+}
+
+TaskAwaiter* InternalCloseAwaiters(TaskHandle handle) noexcept
+{
+	auto awaiters = std::atomic_ref(InternalHandleToState(handle)->awaiters);
+	auto head = awaiters.exchange(TaskState::kAwaitersClosed, std::memory_order_acq_rel);
+
+	ENSUREF(head != TaskState::kAwaitersClosed, "Task awaiters have already been closed!");
+
+	return reinterpret_cast<TaskAwaiter*>(head);//NOLINT(performance-no-int-to-ptr)
+}
+
+void InternalReserve(std::size_t capacity) noexcept
+{
+	gTaskPool.Reserve(capacity);
+}
+
+void InternalSetAllocationNode(uint32_t node) noexcept
+{
+	tlTaskAllocationNode = node;
+}
+
+TaskTraceParent InternalExchangeTraceParent(TaskTraceParent parent) noexcept
+{
+	return std::exchange(tlTaskTraceParent, parent);
+}
+
+TaskAdjacencyChunk* InternalHandleToAdjacencyChunk(TaskAdjacencyChunkHandle handle) noexcept
+{
+	ENSURE(!!handle);
+	ENSURE(handle.value < gTaskAdjacencyChunkPool.Capacity());
+
+	return gTaskAdjacencyChunkPool.GetPointer(handle);
+}
+
+void InternalAddAdjacency(TaskState& state, TaskHandle handle) noexcept
+{
+	ENSURE(state.adjacenciesCount < (1U << 31U) - 1);
+
+	if (state.adjacenciesCount < TaskState::kInlineAdjacencyCount)
+	{
+		state.adjacencies[state.adjacenciesCount++] = handle;
+		return;
+	}
+
+	auto chunkIndex = (state.adjacenciesCount - TaskState::kInlineAdjacencyCount) % TaskAdjacencyChunk::kCapacity;
+
+	if (chunkIndex == 0)
+	{
+		auto chunkHandle = gTaskAdjacencyChunkPool.Allocate(tlTaskAllocationNode);
+
+		ENSUREF(!!chunkHandle, "Task adjacency chunk pool has reached kTaskAdjacencyChunkPoolMaxSize!");
+
+		auto* chunk = std::construct_at(gTaskAdjacencyChunkPool.GetPointer(chunkHandle));
+		chunk->next = state.adjacencyChunks;
+		state.adjacencyChunks = chunkHandle;
+	}
+
+	InternalHandleToAdjacencyChunk(state.adjacencyChunks)->adjacencies[chunkIndex] = handle;
+	state.adjacenciesCount++;
+}
+
+void InternalFreeAdjacencies(TaskState& state) noexcept
+{
+	auto chunkHandle = std::exchange(state.adjacencyChunks, {});
+
+	while (chunkHandle)
+	{
+		auto* chunk = InternalHandleToAdjacencyChunk(chunkHandle);
+		auto next = chunk->next;
+
+		std::destroy_at(chunk);
+		gTaskAdjacencyChunkPool.Free(chunkHandle);
+
+		chunkHandle = next;
+	}
+
+	state.adjacenciesCount = 0;
+}
+
 } // namespace detail
 
 } // namespace core
@@ -56,7 +213,7 @@ void InternalFree(TaskHandle handle) noexcept
 Task::~Task() noexcept
 {
 	myDeleteFcn(myCallableMemory.data(), myArgsMemory.data());
-	std::atomic_store(&InternalState(), {});
+	myState = nullptr;
 }
 
 Task::operator bool() const noexcept
@@ -73,11 +230,40 @@ void Task::AddDependency(Task& other, bool isContinuation) noexcept
 	TaskState& aState = *InternalState();
 	TaskState& bState = *other.InternalState();
 
-	aState.adjacencies[aState.adjacenciesCount++] = core::detail::InternalPtrToHandle(&other);
+	core::detail::InternalAddAdjacency(aState, core::detail::InternalPtrToHandle(&other));
 	std::atomic_ref(bState.latch).fetch_add(1, std::memory_order_relaxed);
 	bState.continuation = isContinuation;
 }
 
+void Task::SetPriority(TaskPriority priority) noexcept
+{
+	ENSURE(*this);
+	ENSURE(priority < kTaskPriorityCount);
+
+	InternalState()->priority = priority;
+}
+
+TaskPriority Task::GetPriority() const noexcept
+{
+	ENSURE(*this);
+
+	return InternalState()->priority;
+}
+
+void Task::SetCancellationToken(CancellationToken&& token) noexcept
+{
+	ENSURE(*this);
+
+	myCancellationToken = std::forward<CancellationToken>(token);
+}
+
+bool Task::InternalIsCancelled() const noexcept
+{
+	ENSURE(*this);
+
+	return std::atomic_ref(myState->cancelled).load(std::memory_order_relaxed) != 0 || myCancellationToken.IsCancellationRequested();
+}
+
 void AddDependency(TaskHandle aTaskHandle, TaskHandle bTaskHandle, bool isContinuation) noexcept
 {
 	ENSURE(!!aTaskHandle);
@@ -90,3 +276,23 @@ void AddDependency(TaskHandle aTaskHandle, TaskHandle bTaskHandle, bool isContin
 	aTask.AddDependency(bTask, isContinuation);
 }
 
+void SetPriority(TaskHandle handle, TaskPriority priority) noexcept
+{
+	ENSURE(!!handle);
+
+	core::detail::InternalHandleToPtr(handle)->SetPriority(priority);
+}
+
+void SetCancellationToken(TaskHandle handle, CancellationToken token) noexcept
+{
+	ENSURE(!!handle);
+
+	core::detail::InternalHandleToPtr(handle)->SetCancellationToken(std::move(token));
+}
+
+TaskPoolStats GetTaskPoolStats() noexcept
+{
+	using namespace core::detail;
+
+	return {.size = gTaskPool.Size(), .capacity = gTaskPool.Capacity(), .highWaterMark = gTaskPool.HighWaterMark()};
+}
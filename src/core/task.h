@@ -1,11 +1,16 @@
 #pragma once
 
+#include "cancellationtoken.h"
 #include "std_extra.h"
 #include "utils.h"
 
+#include <array>
+#include <coroutine>
+#include <exception>
 #include <memory>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 
 #if !defined(__cpp_lib_function_ref) || __cpp_lib_function_ref < 202306L
 #include <tl/function_ref.hpp>
@@ -13,6 +18,17 @@
 
 template <typename T>
 struct TaskCreateInfo;
+struct TaskState;
+
+// ready tasks are always drained from the highest priority lane first.
+// the background lane has bounded starvation protection in TaskExecutor.
+enum TaskPriority : uint8_t
+{
+	kTaskPriorityCritical = 0,
+	kTaskPriorityNormal = 1,
+	kTaskPriorityBackground = 2
+};
+static constexpr std::size_t kTaskPriorityCount = 3;
 
 class alignas (std::hardware_constructive_interference_size) Task final
 {
@@ -37,6 +53,11 @@ public:
 
 	void AddDependency(Task& other, bool isContinuation = false) noexcept;
 
+	void SetPriority(TaskPriority priority) noexcept;
+	[[nodiscard]] TaskPriority GetPriority() const noexcept;
+
+	void SetCancellationToken(CancellationToken&& token) noexcept;
+
 private:
 	template <
 		typename... Params,
@@ -47,10 +68,11 @@ private:
 		typename ParamsTuple = std::tuple<Params...>,
 		typename R = std_extra::apply_result_t<C, std_extra::tuple_cat_t<ArgsTuple, ParamsTuple>>>
 	requires std_extra::applicable<C, std_extra::tuple_cat_t<ArgsTuple, ParamsTuple>>
-	constexpr Task(F&& callable, ParamsTuple&& params, Args&&... args) noexcept;
+	constexpr Task(TaskState& state, F&& callable, ParamsTuple&& params, Args&&... args) noexcept;
 
-	[[nodiscard]] auto& InternalState() noexcept { return myState; }
-	[[nodiscard]] const auto& InternalState() const noexcept { return myState; }
+	[[nodiscard]] TaskState* InternalState() noexcept { return myState; }
+	[[nodiscard]] const TaskState* InternalState() const noexcept { return myState; }
+	[[nodiscard]] bool InternalIsCancelled() const noexcept; // by its own token, or by one of its dependencies having been dropped
 
 	static constexpr size_t kTaskSize = 256;
 	static constexpr size_t kMaxCallableSizeBytes = ((kTaskSize == 256) ? 128 : ((kTaskSize == 128) ? 48 : 0));
@@ -66,19 +88,82 @@ private:
 	alignas(8) tl::function_ref<void(void*, const void*, void*, const void*)> myInvokeFcn;
 	alignas(8) tl::function_ref<void(void*, void*)> myDeleteFcn;
 #endif
-	alignas(8) std::shared_ptr<struct TaskState> myState;
+	alignas(8) TaskState* myState = nullptr; // lives next to the task in the same pool slot, but may outlive the task itself
+	CancellationToken myCancellationToken;
+};
+
+// the task pool grows on demand (in segments) up to kTaskPoolMaxSize tasks in flight.
+// kTaskPoolMaxSize is the largest size that still keeps TaskHandle at 16 bits.
+static constexpr std::size_t kTaskPoolMaxSize = (1 << 15) - 1;
+static constexpr std::size_t kTaskPoolDefaultCapacity = (1 << 10);
+using TaskHandle = MinSizeIndex<kTaskPoolMaxSize>;
+static_assert(sizeof(TaskHandle) == sizeof(uint16_t));
+
+static constexpr std::size_t kTaskAdjacencyChunkPoolMaxSize = (1 << 15) - 1;
+using TaskAdjacencyChunkHandle = MinSizeIndex<kTaskAdjacencyChunkPoolMaxSize>;
+
+// overflow storage for the dependents of a task that doesn't fit in TaskState::adjacencies. allocated from a pool shared by all tasks.
+struct TaskAdjacencyChunk
+{
+	static constexpr std::size_t kCapacity = 31;
+
+	std::array<TaskHandle, kCapacity> adjacencies;
+	TaskAdjacencyChunkHandle next{};
+};
+static_assert(sizeof(TaskAdjacencyChunk) == 64);
+
+struct TaskPoolStats
+{
+	std::size_t size = 0;
+	std::size_t capacity = 0;
+	std::size_t highWaterMark = 0;
 };
 
-static constexpr std::size_t kTaskPoolSize = (1 << 10); // todo: make this configurable
-using TaskHandle = MinSizeIndex<kTaskPoolSize>;
+// trace id of the task running on a thread (0 outside of tasks), and the number of tasks it has created so far
+struct TaskTraceParent
+{
+	uint64_t id = 0;
+	uint64_t childCount = 0;
+};
 
+// intrusive list node for a coroutine suspended on a task. lives in the suspended coroutine frame.
+struct TaskAwaiter
+{
+	TaskAwaiter* next = nullptr;
+	std::coroutine_handle<> continuation;
+	TaskPriority priority = kTaskPriorityNormal;
+};
+
+// Stored in the same pool slot as its Task. The slot is reference counted (task + futures),
+// so the state (and the return value) stays valid after the task itself has been destroyed.
 struct TaskState
 {
-	std::array<TaskHandle, 128> adjacencies;
+	static constexpr size_t kMaxValueSizeBytes = 64;
+	static constexpr size_t kMaxValueAlignment = 16;
+	static constexpr uintptr_t kAwaitersClosed = 1; // set by the executor once the task has finished
+	static constexpr size_t kInlineAdjacencyCount = 6; // most tasks have very few dependents
+
+	template <typename T>
+	[[nodiscard]] T& Value() noexcept { return *std::launder(reinterpret_cast<T*>(value.data())); }
+
+	template <typename F>
+	void ForEachAdjacency(F&& fn) const;
+
+	std::array<TaskHandle, kInlineAdjacencyCount> adjacencies; // the first dependents, the rest go into adjacencyChunks
+	TaskAdjacencyChunkHandle adjacencyChunks{}; // linked list, most recently allocated (and only partially filled) chunk first
 	static constexpr auto kAligmnent = std::atomic_ref<uint16_t>::required_alignment;
 	alignas(kAligmnent) uint16_t latch{1U};
-	uint8_t adjacenciesCount : 7;
-	uint8_t continuation : 1;
+	alignas(std::atomic_ref<uint32_t>::required_alignment) uint32_t refCount{1U};
+	alignas(std::atomic_ref<uintptr_t>::required_alignment) uintptr_t awaiters{0}; // TaskAwaiter* list or kAwaitersClosed
+	uint32_t adjacenciesCount : 31 {0};
+	uint32_t continuation : 1 {0};
+	TaskPriority priority{kTaskPriorityNormal};
+	alignas(std::atomic_ref<uint8_t>::required_alignment) uint8_t cancelled{0}; // set by the executor when the task was dropped instead of run, and propagated to its dependents
+	void (*valueDeleteFcn)(void*) = nullptr;
+	int64_t submitTime = 0; // steady clock nanoseconds when the task was submitted, 0 if it never was. used for executor telemetry
+	uint64_t traceId = 0; // derived from the creating tasks traceId and creation order, so it is stable between runs. used for executor record/replay
+	std::exception_ptr exception; // set for the completion task of a coroutine that exited with an exception. rethrown by Future::Get
+	alignas(kMaxValueAlignment) std::array<std::byte, kMaxValueSizeBytes> value;
 };
 
 template <typename T>
@@ -86,27 +171,46 @@ class Future
 {
 public:
 	using value_t = std::conditional_t<std::is_void_v<T>, std::nullptr_t, T>;
-	struct FutureState : TaskState { value_t value; };
 
 	constexpr Future() noexcept = default;
-	explicit Future(std::shared_ptr<FutureState>&& state) noexcept;
+	Future(TaskHandle handle, uint16_t generation) noexcept; // takes over one reference to the slot
 	Future(Future&& other) noexcept;
 	Future(const Future& other) noexcept;
+	~Future() noexcept;
 	
 	[[nodiscard]] bool operator==(const Future& other) const noexcept;
 	[[maybe_unused]] Future& operator=(Future&& other) noexcept;
 	[[maybe_unused]] Future& operator=(const Future& other) noexcept;
 
-	[[nodiscard]] value_t Get();
+	[[nodiscard]] value_t Get(); // rethrows the exception of a spawned coroutine that exited with one
 	[[nodiscard]] bool IsReady() const noexcept;
+	[[nodiscard]] bool IsCancelled() const noexcept; // only meaningful once the future is ready. Get returns a default constructed value for cancelled tasks
 	[[nodiscard]] bool Valid() const noexcept;
 	void Wait() const;
 
+	// co_await suspends the calling coroutine (instead of blocking the thread) until the task has finished.
+	// resumption is scheduled as a new task on the executor that ran the awaited task.
+	struct Awaiter;
+	[[nodiscard]] Awaiter operator co_await() const noexcept;
+
 private:
-	[[nodiscard]] auto& InternalState() noexcept { return myState; }
-	[[nodiscard]] const auto& InternalState() const noexcept { return myState; }
+	[[nodiscard]] TaskState& InternalState() const noexcept;
+	void InternalRelease() noexcept;
 
-	std::shared_ptr<FutureState> myState;
+	TaskHandle myHandle{};
+	uint16_t myGeneration = 0;
+};
+
+template <typename T>
+struct Future<T>::Awaiter
+{
+	[[nodiscard]] bool await_ready() const noexcept { return future.IsReady(); }
+	template <typename Promise>
+	[[nodiscard]] bool await_suspend(std::coroutine_handle<Promise> continuation) noexcept;
+	[[nodiscard]] value_t await_resume() { return future.Get(); }
+
+	Future future;
+	TaskAwaiter node;
 };
 
 template <typename T>
@@ -130,5 +234,14 @@ requires std_extra::applicable<C, std_extra::tuple_cat_t<ArgsTuple, ParamsTuple>
 // b will start after a has finished
 void AddDependency(TaskHandle aTaskHandle, TaskHandle bTaskHandle, bool isContinuation = false) noexcept;
 
+// needs to be called before the task is submitted
+void SetPriority(TaskHandle handle, TaskPriority priority) noexcept;
+
+// needs to be called before the task is submitted. the task is dropped without running if token is cancelled (or has expired) by the time it is dequeued
+void SetCancellationToken(TaskHandle handle, CancellationToken token) noexcept;
+
+// use highWaterMark to size the initial pool capacity passed to TaskExecutor
+[[nodiscard]] TaskPoolStats GetTaskPoolStats() noexcept;
+
 #include "task.inl"
 #include "future.inl"
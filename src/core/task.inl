@@ -1,5 +1,6 @@
 #include "assert.h"//NOLINT(modernize-deprecated-headers)
 
+#include <algorithm>
 #include <atomic>
 
 namespace core
@@ -8,9 +9,20 @@ namespace detail
 {
 
 Task* InternalHandleToPtr(TaskHandle handle) noexcept;
+TaskState* InternalHandleToState(TaskHandle handle) noexcept;
 TaskHandle InternalPtrToHandle(Task* ptr) noexcept;
-TaskHandle InternalAllocate() noexcept;
-void InternalFree(TaskHandle handle) noexcept;
+TaskHandle InternalAllocate() noexcept; // returns a slot with a constructed TaskState holding one reference
+void InternalRetain(TaskHandle handle) noexcept;
+void InternalRelease(TaskHandle handle) noexcept; // slot is returned to the pool when the last reference is released
+[[nodiscard]] uint16_t InternalGeneration(TaskHandle handle) noexcept;
+[[nodiscard]] bool InternalTryAwait(TaskHandle handle, TaskAwaiter& awaiter) noexcept; // returns false if the task has already finished
+[[nodiscard]] TaskAwaiter* InternalCloseAwaiters(TaskHandle handle) noexcept;
+void InternalReserve(std::size_t capacity) noexcept;
+void InternalSetAllocationNode(uint32_t node) noexcept; // NUMA node that tasks created on the calling thread are allocated from
+TaskTraceParent InternalExchangeTraceParent(TaskTraceParent parent) noexcept; // tasks created on the calling thread derive their traceId from parent
+[[nodiscard]] TaskAdjacencyChunk* InternalHandleToAdjacencyChunk(TaskAdjacencyChunkHandle handle) noexcept;
+void InternalAddAdjacency(TaskState& state, TaskHandle handle) noexcept;
+void InternalFreeAdjacencies(TaskState& state) noexcept;
 
 template <typename C, typename ArgsTuple, typename ParamsTuple, typename R>
 static void InternalInvoke(void* callablePtr, const void* argsPtr, void* statePtr, const void* paramsPtr)
@@ -21,12 +33,12 @@ static void InternalInvoke(void* callablePtr, const void* argsPtr, void* statePt
 
 	ENSUREF(statePtr, "Task::operator() called without any return state!");
 
-	auto& state = *static_cast<typename Future<R>::FutureState*>(statePtr);
+	auto& state = *static_cast<TaskState*>(statePtr);
 
 	if constexpr (std::is_void_v<R>)
 		std::apply(callable, std::tuple_cat(args, params));
 	else
-		state.value = std::apply(callable, std::tuple_cat(args, params));
+		state.Value<R>() = std::apply(callable, std::tuple_cat(args, params));
 
 	auto latch = std::atomic_ref(state.latch);
 	auto counter = latch.fetch_sub(1, std::memory_order_release) - 1;
@@ -42,18 +54,57 @@ static void InternalDelete(void* callablePtr, void* argsPtr)
 	std::destroy_at(static_cast<ArgsTuple*>(argsPtr));
 }
 
+template <typename T>
+static void InternalDeleteValue(void* valuePtr)
+{
+	std::destroy_at(static_cast<T*>(valuePtr));
+}
+
 } // namespace detail
 
 } // namespace core
 
+template <typename F>
+void TaskState::ForEachAdjacency(F&& fn) const
+{
+	auto inlineCount = std::min<uint32_t>(adjacenciesCount, kInlineAdjacencyCount);
+	for (uint32_t adjIt = 0; adjIt < inlineCount; adjIt++)
+		fn(adjacencies[adjIt]);
+
+	if (adjacenciesCount <= kInlineAdjacencyCount)
+		return;
+
+	// only the first chunk in the list can be partially filled
+	auto chunkCount = ((adjacenciesCount - kInlineAdjacencyCount - 1) % TaskAdjacencyChunk::kCapacity) + 1;
+	auto chunkHandle = adjacencyChunks;
+
+	while (chunkHandle)
+	{
+		const auto& chunk = *core::detail::InternalHandleToAdjacencyChunk(chunkHandle);
+
+		for (uint32_t adjIt = 0; adjIt < chunkCount; adjIt++)
+			fn(chunk.adjacencies[adjIt]);
+
+		chunkHandle = chunk.next;
+		chunkCount = TaskAdjacencyChunk::kCapacity;
+	}
+}
+
 template <typename... Params, typename... Args, typename F, typename C, typename ArgsTuple, typename ParamsTuple, typename R>
 requires std_extra::applicable<C, std_extra::tuple_cat_t<ArgsTuple, ParamsTuple>>
-constexpr Task::Task(F&& callable, ParamsTuple&& params, Args&&... args) noexcept
+constexpr Task::Task(TaskState& state, F&& callable, ParamsTuple&& params, Args&&... args) noexcept
 	: myInvokeFcn(core::detail::InternalInvoke<C, ArgsTuple, ParamsTuple, R>)
 	, myDeleteFcn(core::detail::InternalDelete<C, ArgsTuple>)
-//	, myState(std::static_pointer_cast<TaskState>(std::make_shared<typename Future<R>::FutureState>()))
+	, myState(&state)
 {
-	std::atomic_store(&InternalState(), std::static_pointer_cast<TaskState>(std::make_shared<typename Future<R>::FutureState>()));
+	using value_t = typename Future<R>::value_t;
+
+	static_assert(sizeof(value_t) <= TaskState::kMaxValueSizeBytes, "Task return value does not fit in TaskState::value!");
+	static_assert(alignof(value_t) <= TaskState::kMaxValueAlignment, "Task return value is overaligned!");
+	std::construct_at(
+		static_cast<value_t*>(static_cast<void*>(state.value.data())),//NOLINT(bugprone-casting-through-void)
+		value_t{});
+	state.valueDeleteFcn = core::detail::InternalDeleteValue<value_t>;
 
 	static_assert(sizeof(C) <= kMaxCallableSizeBytes);
 	std::construct_at(
@@ -76,7 +127,7 @@ inline constexpr void Task::operator()(Params&&... params)
 	ENSURE(*this);
 
 	auto taskParams = std::make_tuple(std::forward<Params>(params)...);
-	myInvokeFcn(myCallableMemory.data(), myArgsMemory.data(), std::atomic_load(&InternalState()).get(), &taskParams);
+	myInvokeFcn(myCallableMemory.data(), myArgsMemory.data(), InternalState(), &taskParams);
 }
 
 template <typename... Params, typename... Args, typename F, typename C, typename ArgsTuple, typename ParamsTuple, typename R>
@@ -94,15 +145,18 @@ TaskCreateInfo<R> CreateTask(F&& callable, Args&&... args) noexcept
 		// 	std::forward<Args>(args)...);
 
 		new (&task) Task(
+			*core::detail::InternalHandleToState(handle),
 			std::forward<F>(callable),
 			ParamsTuple{},
 			std::forward<Args>(args)...);
 
-		return { .handle = handle, .future = Future<R>(
-			std::static_pointer_cast<typename Future<R>::FutureState>(std::atomic_load(&task.InternalState()))) };
+		// one reference is held by the task itself (released by the executor as soon as the task has run) and one by the returned future
+		core::detail::InternalRetain(handle);
+
+		return { .handle = handle, .future = Future<R>(handle, core::detail::InternalGeneration(handle)) };
 	}
 
-	ENSUREF(false, "Task::InternalAllocate() failed, pool is full?");
+	ENSUREF(false, "Task::InternalAllocate() failed, pool has reached kTaskPoolMaxSize?");
 
 	return {};
 }
@@ -1,8 +1,20 @@
 #include "taskexecutor.h"
 #include "assert.h"//NOLINT(modernize-deprecated-headers)
 
+#include <algorithm>
 #include <atomic>
-#include <shared_mutex>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cctype>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <string>
 
 // #if !defined(__cpp_lib_atomic_shared_ptr) || __cpp_lib_atomic_shared_ptr < 201711L
 // static_assert(false, "std::atomic<std::shared_ptr> is not supported by the standard library!");
@@ -12,6 +24,9 @@
 #	include <windows.h>
 #else
 #	include <pthread.h>
+#	if !defined(__APPLE__)
+#		include <sched.h>
+#	endif
 #endif
 namespace taskexecutor
 {
@@ -55,6 +70,16 @@ void SetThreadName(std::jthread& thread, const char* threadName)
 	SetThreadName(::GetThreadId(static_cast<HANDLE>(thread.native_handle())), threadName);
 }
 
+bool SetCurrentThreadAffinity(uint32_t cpu)
+{
+	return cpu < 64 && SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << cpu) != 0;
+}
+
+[[nodiscard]] uint32_t GetCurrentCpu() noexcept
+{
+	return GetCurrentProcessorNumber();
+}
+
 #elif defined(__APPLE__)
 
 void SetThreadName(const char* threadName)
@@ -67,6 +92,17 @@ void SetThreadName(std::jthread& /*thread*/, const char* threadName)
 	SetThreadName(threadName);
 }
 
+bool SetCurrentThreadAffinity(uint32_t /*cpu*/)
+{
+	// not supported. the thread affinity API on macOS only provides hints.
+	return false;
+}
+
+[[nodiscard]] uint32_t GetCurrentCpu() noexcept
+{
+	return 0;
+}
+
 #else
 
 void SetThreadName(std::jthread& thread, const char* threadName)
@@ -75,6 +111,25 @@ void SetThreadName(std::jthread& thread, const char* threadName)
 	pthread_setname_np(handle, threadName);
 }
 
+bool SetCurrentThreadAffinity(uint32_t cpu)
+{
+	if (cpu >= CPU_SETSIZE)
+		return false;
+
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpu, &cpuSet);
+	
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+}
+
+[[nodiscard]] uint32_t GetCurrentCpu() noexcept
+{
+	auto cpu = sched_getcpu();
+
+	return cpu < 0 ? 0 : static_cast<uint32_t>(cpu);
+}
+
 #endif
 
 enum TaskExecutorState : uint8_t
@@ -84,17 +139,330 @@ enum TaskExecutorState : uint8_t
 };
 static std::atomic<TaskExecutorState> gTaskExecutorState = kTaskExecutorInitializing;
 
+struct WorkerContext
+{
+	const TaskExecutor* executor = nullptr;
+	std::array<WorkStealingDeque<TaskHandle>, kTaskPriorityCount>* queues = nullptr;
+	uint32_t index = 0;
+	uint32_t node = 0;
+	uint32_t stealSeed = 0;
+	uint32_t backgroundStarvation = 0;
+};
+static thread_local WorkerContext tlWorkerContext;
+
+[[nodiscard]] static WorkStealingDeque<TaskHandle>* GetLocalQueue(const TaskExecutor* executor, TaskPriority priority) noexcept
+{
+	return tlWorkerContext.executor == executor ? &(*tlWorkerContext.queues)[priority] : nullptr;
+}
+
+[[nodiscard]] static uint32_t NextStealSeed() noexcept
+{
+	// xorshift32
+	auto& seed = tlWorkerContext.stealSeed;
+	if (seed == 0)
+		seed = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1U;
+	seed ^= seed << 13U;
+	seed ^= seed >> 17U;
+	seed ^= seed << 5U;
+	return seed;
+}
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+[[nodiscard]] static std::optional<std::vector<uint32_t>> ParseCpuList(std::string_view list)
+{
+	std::vector<uint32_t> cpus;
+
+	auto parseNumber = [](std::string_view str, uint32_t& value)
+	{
+		auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+		return ec == std::errc{} && ptr == str.data() + str.size();
+	};
+
+	while (!list.empty())
+	{
+		auto rangeEnd = list.find(',');
+		auto range = list.substr(0, rangeEnd);
+		list = rangeEnd == std::string_view::npos ? std::string_view{} : list.substr(rangeEnd + 1);
+
+		while (!range.empty() && std::isspace(static_cast<unsigned char>(range.back())))
+			range.remove_suffix(1);
+		while (!range.empty() && std::isspace(static_cast<unsigned char>(range.front())))
+			range.remove_prefix(1);
+
+		if (range.empty())
+			continue;
+
+		uint32_t first = 0;
+		uint32_t last = 0;
+		if (auto dash = range.find('-'); dash != std::string_view::npos)
+		{
+			if (!parseNumber(range.substr(0, dash), first) || !parseNumber(range.substr(dash + 1), last) || last < first)
+				return std::nullopt;
+		}
+		else if (!parseNumber(range, first))
+		{
+			return std::nullopt;
+		}
+		else
+		{
+			last = first;
+		}
+
+		for (auto cpu = first; cpu <= last; cpu++)
+			cpus.push_back(cpu);
+	}
+
+	return cpus;
+}
+
+[[nodiscard]] static std::optional<std::string> ReadFirstLine(const std::filesystem::path& path)
+{
+	std::ifstream file(path);
+	std::string line;
+
+	if (!file || !std::getline(file, line))
+		return std::nullopt;
+
+	return line;
+}
+
+#if defined(__linux__)
+// the cpus this process may run on. under taskset or a cpuset cgroup, that is a subset of the online cpus.
+[[nodiscard]] static std::optional<std::vector<uint32_t>> GetAllowedCpus()
+{
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+
+	if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) != 0)
+		return std::nullopt;
+
+	std::vector<uint32_t> cpus;
+	for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		if (CPU_ISSET(cpu, &cpuSet))
+			cpus.push_back(cpu);
+
+	return cpus;
+}
+#endif
+
+} // namespace taskexecutor
+
+uint64_t TaskExecutorHistogram::Count() const noexcept
+{
+	return std::accumulate(buckets.begin(), buckets.end(), uint64_t{0});
+}
+
+uint64_t TaskExecutorHistogram::Percentile(double fraction) const noexcept
+{
+	auto target = static_cast<uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(Count())));
+	uint64_t count = 0;
+
+	for (std::size_t bucketIt = 0; bucketIt < kBucketCount; bucketIt++)
+	{
+		count += buckets[bucketIt];
+
+		if (count >= target && count > 0)
+			return uint64_t{1} << bucketIt;
+	}
+
+	return 0;
+}
+
+TaskExecutorHistogram& TaskExecutorHistogram::operator+=(const TaskExecutorHistogram& other) noexcept
+{
+	for (std::size_t bucketIt = 0; bucketIt < kBucketCount; bucketIt++)
+		buckets[bucketIt] += other.buckets[bucketIt];
+
+	return *this;
+}
+
+TaskExecutorHistogram& TaskExecutorHistogram::operator-=(const TaskExecutorHistogram& other) noexcept
+{
+	for (std::size_t bucketIt = 0; bucketIt < kBucketCount; bucketIt++)
+		buckets[bucketIt] -= other.buckets[bucketIt];
+
+	return *this;
+}
+
+TaskExecutorWorkerStats& TaskExecutorWorkerStats::operator+=(const TaskExecutorWorkerStats& other) noexcept
+{
+	tasksExecuted += other.tasksExecuted;
+	tasksCancelled += other.tasksCancelled;
+	steals += other.steals;
+	idleNanoseconds += other.idleNanoseconds;
+	queueDepth += other.queueDepth;
+	submitToStart += other.submitToStart;
+	startToFinish += other.startToFinish;
+
+	return *this;
 }
 
-TaskExecutor::TaskExecutor(uint32_t threadCount)
+TaskExecutorWorkerStats& TaskExecutorWorkerStats::operator-=(const TaskExecutorWorkerStats& other) noexcept
+{
+	// queue depths are samples, not counters, so they are kept as is
+	tasksExecuted -= other.tasksExecuted;
+	tasksCancelled -= other.tasksCancelled;
+	steals -= other.steals;
+	idleNanoseconds -= other.idleNanoseconds;
+	submitToStart -= other.submitToStart;
+	startToFinish -= other.startToFinish;
+
+	return *this;
+}
+
+TaskExecutorWorkerStats TaskExecutorStats::Total() const noexcept
+{
+	TaskExecutorWorkerStats total;
+
+	for (const auto& worker : workers)
+		total += worker;
+
+	return total;
+}
+
+TaskExecutorTopology TaskExecutorTopology::FromSystem()
+{
+	using namespace taskexecutor;
+
+	TaskExecutorTopology topology;
+
+#if defined(__linux__)
+	const std::filesystem::path cpuRoot("/sys/devices/system/cpu");
+
+	auto cpus = GetAllowedCpus();
+	if (!cpus || cpus->empty())
+	{
+		auto online = ReadFirstLine(cpuRoot / "online");
+		cpus = online ? ParseCpuList(*online) : std::nullopt;
+	}
+
+	if (cpus && !cpus->empty())
+	{
+		std::map<uint32_t, std::vector<uint32_t>> nodes; // sorted by (possibly sparse) node id
+
+		for (auto cpu : *cpus)
+		{
+			auto cpuPath = cpuRoot / std::format("cpu{}", cpu);
+			std::optional<uint32_t> nodeId;
+
+			// numa kernels expose the node as a cpuN/nodeM link. fall back to the socket id otherwise.
+			std::error_code error;
+			for (const auto& entry : std::filesystem::directory_iterator(cpuPath, error))
+			{
+				auto name = entry.path().filename().string();
+				uint32_t id = 0;
+				if (name.starts_with("node") &&
+					std::from_chars(name.data() + 4, name.data() + name.size(), id).ec == std::errc{})
+				{
+					nodeId = id;
+					break;
+				}
+			}
+
+			if (!nodeId)
+				if (auto package = ReadFirstLine(cpuPath / "topology" / "physical_package_id"))
+					if (uint32_t id = 0; std::from_chars(package->data(), package->data() + package->size(), id).ec == std::errc{})
+						nodeId = id;
+
+			nodes[nodeId.value_or(0)].push_back(cpu);
+		}
+
+		for (auto& [nodeId, nodeCpus] : nodes)
+			topology.nodes.emplace_back(std::move(nodeCpus));
+
+		topology.pinThreads = true;
+
+		return topology;
+	}
+#endif
+
+	auto& cpusOut = topology.nodes.emplace_back();
+	for (uint32_t cpu = 0; cpu < std::max(1U, std::thread::hardware_concurrency()); cpu++)
+		cpusOut.push_back(cpu);
+
+	return topology;
+}
+
+TaskExecutorTopology TaskExecutorTopology::Parse(std::string_view spec)
+{
+	using namespace taskexecutor;
+
+	TaskExecutorTopology topology;
+
+	while (!spec.empty())
+	{
+		auto nodeEnd = spec.find(';');
+		auto cpus = ParseCpuList(spec.substr(0, nodeEnd));
+
+		if (!cpus || cpus->empty())
+			return {};
+
+		topology.nodes.emplace_back(std::move(*cpus));
+
+		spec = nodeEnd == std::string_view::npos ? std::string_view{} : spec.substr(nodeEnd + 1);
+	}
+
+	topology.pinThreads = !topology.nodes.empty();
+
+	return topology;
+}
+
+TaskExecutor::TaskExecutor(uint32_t threadCount, uint32_t taskPoolCapacity, const TaskExecutorTopology& topology)
 {
 	using namespace taskexecutor;
 
 	ZoneScopedN("TaskExecutor()");
 
 	ENSUREF(threadCount > 0, "Thread count must be nonzero");
+	ENSUREF(taskPoolCapacity <= kTaskPoolMaxSize, "Task pool capacity must not exceed kTaskPoolMaxSize");
+
+	core::detail::InternalReserve(taskPoolCapacity);
+	myTaskPoolCapacity = taskPoolCapacity;
+
+	auto nodeCount = static_cast<uint32_t>(std::max<std::size_t>(topology.nodes.size(), 1));
+
+	myReadyQueues.reserve(nodeCount);
+	myNodeWorkers.resize(nodeCount);
+
+	for (uint32_t nodeIt = 0; nodeIt < nodeCount; nodeIt++)
+		myReadyQueues.emplace_back(std::make_unique<ReadyQueues>());
+
+	for (uint32_t nodeIt = 0; nodeIt < topology.nodes.size(); nodeIt++)
+	{
+		for (auto cpu : topology.nodes[nodeIt])
+		{
+			if (cpu >= myCpuNodes.size())
+				myCpuNodes.resize(cpu + 1, 0);
+
+			myCpuNodes[cpu] = nodeIt;
+		}
+	}
 
 	myThreads.reserve(threadCount);
+	myWorkerQueues.reserve(threadCount);
+	myWorkerNodes.reserve(threadCount);
+	myWorkerCpus.reserve(threadCount);
+	myCounters.reserve(threadCount + 1);
+	myParkingSlots.reserve(threadCount);
+
+	for (uint32_t threadIt = 0; threadIt < threadCount; threadIt++)
+	{
+		// round robin over the nodes, so that every node gets a fair share of workers when there are less workers than cpus
+		auto node = threadIt % nodeCount;
+		int64_t cpu = -1;
+
+		if (topology.pinThreads && node < topology.nodes.size() && !topology.nodes[node].empty())
+			cpu = topology.nodes[node][(threadIt / nodeCount) % topology.nodes[node].size()];
+
+		myWorkerQueues.emplace_back(std::make_unique<WorkerQueues>());
+		myParkingSlots.emplace_back(std::make_unique<ParkingSlot>());
+		myWorkerNodes.push_back(node);
+		myWorkerCpus.push_back(cpu);
+		myNodeWorkers[node].push_back(threadIt);
+	}
+
+	for (uint32_t counterIt = 0; counterIt < threadCount + 1; counterIt++)
+		myCounters.emplace_back(std::make_unique<WorkerCounters>());
 
 	for (uint32_t threadIt = 0; threadIt < threadCount; threadIt++)
 		myThreads.emplace_back(std::bind_front(&TaskExecutor::InternalThreadMain, this), threadIt);
@@ -107,80 +475,644 @@ TaskExecutor::~TaskExecutor()
 {
 	ZoneScopedN("~TaskExecutor()");
 
-	ASSERT(myReadyQueue.size_approx() == 0);
-	ASSERT(myDeletionQueue.size_approx() == 0);
+	for (const auto& queues : myReadyQueues)
+		for (const auto& queue : *queues)
+			ASSERT(queue.size_approx() == 0);
 
 	myStopSource.request_stop();
+	InternalWake(myThreads.size());
 
 	for (auto& thread : myThreads)
 		thread.join();
+
+	for (const auto& queues : myWorkerQueues)
+		for (const auto& queue : *queues)
+			ASSERT(queue.Empty());
+
+	// growing the pool stalls whoever creates the task that does not fit, so it should be sized for the peak up front
+	if (auto taskPool = GetTaskPoolStats(); taskPool.highWaterMark > myTaskPoolCapacity)
+		std::cerr << "Task pool grew past its initial capacity: " << myTaskPoolCapacity << ", High water mark: " << taskPool.highWaterMark << '\n';
 }
 
-bool TaskExecutor::InternalTryDelete(TaskHandle handle)
+void TaskExecutor::InternalDelete(Task& task, TaskHandle handle)
 {
-	ZoneScopedN("TaskExecutor::InternalTryDelete");
+	ZoneScopedN("TaskExecutor::InternalDelete");
 
-	Task& task = *core::detail::InternalHandleToPtr(handle);
-	ENSURE(task);
-	auto& state = *std::atomic_load(&task.InternalState());
-	
-	if (std::atomic_ref(state.latch).load(std::memory_order_relaxed) == 0)
-	{
-		std::destroy_at(&task);
-		core::detail::InternalFree(handle);
-		return true;
-	}
+	ENSURE(std::atomic_ref(task.InternalState()->latch).load(std::memory_order_relaxed) == 0);
 
-	return false;
+	// the captures go as soon as the task has finished. the slot (and the return value) is returned to the pool
+	// by whoever drops the last reference, which may just as well be a Future on another thread.
+	std::destroy_at(&task);
+	core::detail::InternalRelease(handle);
 }
 
 void TaskExecutor::InternalScheduleAdjacent(Task& task)
 {
 	ZoneScopedN("TaskExecutor::InternalScheduleAdjacent");
 
-	auto& state = *std::atomic_load(&task.InternalState());
+	auto& state = *task.InternalState();
+	auto cancelled = std::atomic_ref(state.cancelled).load(std::memory_order_relaxed);
 
-	for (auto adjIt = 0; adjIt < state.adjacenciesCount; adjIt++)
+	state.ForEachAdjacency([this, cancelled](TaskHandle adjacentHandle)
 	{
-		TaskHandle adjacentHandle = state.adjacencies[adjIt];
 		Task& adjacent = *core::detail::InternalHandleToPtr(adjacentHandle);
 		ENSURE(adjacent);
-		auto& adjacentState = *std::atomic_load(&adjacent.InternalState());
+		auto& adjacentState = *adjacent.InternalState();
 		auto adjacentLatch = std::atomic_ref(adjacentState.latch);
 		ENSUREF(adjacentLatch, "Latch needs to have been constructed!");
 
-		if (adjacentLatch.fetch_sub(1, std::memory_order_relaxed) - 1 == 1)
+		// dependents of a dropped task can not run either. published by the latch decrement below
+		if (cancelled != 0)
+			std::atomic_ref(adjacentState.cancelled).store(cancelled, std::memory_order_relaxed);
+
+		if (adjacentLatch.fetch_sub(1, std::memory_order_acq_rel) - 1 == 1)
 			Submit({&adjacentHandle, 1}, !adjacentState.continuation);
+	});
+}
+
+void TaskExecutor::InternalScheduleAwaiters(TaskHandle handle)
+{
+	ZoneScopedN("TaskExecutor::InternalScheduleAwaiters");
+
+	auto* awaiter = core::detail::InternalCloseAwaiters(handle);
+
+	while (awaiter != nullptr)
+	{
+		// the awaiter lives in the coroutine frame, so everything must be read before the coroutine can be resumed
+		auto* next = awaiter->next;
+		auto [resumeHandle, resumeFuture] = CreateTask([continuation = awaiter->continuation] { continuation.resume(); });
+		SetPriority(resumeHandle, awaiter->priority);
+
+		Submit({&resumeHandle, 1});
+
+		awaiter = next;
 	}
 }
 
+bool TaskExecutor::InternalTrySteal(TaskHandle& handle, TaskPriority priority, uint32_t node)
+{
+	using namespace taskexecutor;
+
+	ZoneScopedN("TaskExecutor::InternalTrySteal");
+
+	const auto& workers = myNodeWorkers[node];
+	auto queueCount = static_cast<uint32_t>(workers.size());
+	auto* localQueue = GetLocalQueue(this, priority);
+
+	if (queueCount == 0)
+		return false;
+
+	// start at a random victim to avoid all thieves hammering the same deque
+	for (uint32_t queueIt = 0, queueOffset = NextStealSeed() % queueCount; queueIt < queueCount; queueIt++)
+	{
+		auto& victim = (*myWorkerQueues[workers[(queueIt + queueOffset) % queueCount]])[priority];
+
+		if (&victim == localQueue)
+			continue;
+
+		if (auto stolen = victim.Steal())
+		{
+			handle = *stolen;
+			InternalCounters().steals.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool TaskExecutor::InternalTryDequeue(TaskHandle& handle, TaskPriority priority)
+{
+	using namespace taskexecutor;
+
+	if (auto* localQueue = GetLocalQueue(this, priority))
+	{
+		if (auto local = localQueue->Pop())
+		{
+			handle = *local;
+			return true;
+		}
+	}
+
+	// own node first, then the remote nodes
+	auto node = InternalCurrentNode();
+	auto nodeCount = static_cast<uint32_t>(myReadyQueues.size());
+
+	for (uint32_t nodeIt = 0; nodeIt < nodeCount; nodeIt++)
+	{
+		auto victimNode = (node + nodeIt) % nodeCount;
+
+		if ((*myReadyQueues[victimNode])[priority].try_dequeue(handle))
+			return true;
+
+		if (InternalTrySteal(handle, priority, victimNode))
+			return true;
+	}
+
+	return false;
+}
+
+bool TaskExecutor::InternalTryDequeue(TaskHandle& handle)
+{
+	using namespace taskexecutor;
+
+	if (myTraceMode.load(std::memory_order_acquire) == kTraceReplaying) [[unlikely]]
+		return InternalReplayTryDequeue(handle);
+
+	auto& starvation = tlWorkerContext.backgroundStarvation;
+
+	if (starvation >= kBackgroundStarvationLimit)
+	{
+		// reset even if the background lane turns out to be empty, since then nothing is starving, and the next dequeues
+		// should not pay for another sweep of it
+		starvation = 0;
+
+		if (InternalTryDequeue(handle, kTaskPriorityBackground))
+			return true;
+	}
+
+	for (uint8_t priorityIt = 0; priorityIt < kTaskPriorityCount; priorityIt++)
+	{
+		auto priority = static_cast<TaskPriority>(priorityIt);
+
+		if (InternalTryDequeue(handle, priority))
+		{
+			starvation = (priority == kTaskPriorityBackground) ? 0 : starvation + 1;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool TaskExecutor::InternalHasReadyTasks() const noexcept
+{
+	// held back tasks are only released by a dequeue, so keep workers polling while there are any
+	if (myTraceMode.load(std::memory_order_acquire) == kTraceReplaying && myTrace->heldCount.load(std::memory_order_relaxed) > 0) [[unlikely]]
+		return true;
+
+	if (std::ranges::any_of(myReadyQueues, [](const auto& queues)
+	{
+		return std::ranges::any_of(*queues, [](const auto& queue) { return queue.size_approx() > 0; });
+	}))
+		return true;
+
+	return std::ranges::any_of(myWorkerQueues, [](const auto& queues)
+	{
+		return std::ranges::any_of(*queues, [](const auto& queue) { return !queue.Empty(); });
+	});
+}
+
+uint32_t TaskExecutor::InternalCurrentNode() const noexcept
+{
+	using namespace taskexecutor;
+
+	if (tlWorkerContext.executor == this)
+		return tlWorkerContext.node;
+
+	if (myCpuNodes.empty())
+		return 0;
+
+	auto cpu = GetCurrentCpu();
+
+	return cpu < myCpuNodes.size() ? myCpuNodes[cpu] : 0;
+}
+
 void TaskExecutor::InternalProcessReadyQueue()
 {
 	ZoneScopedN("TaskExecutor::InternalProcessReadyQueue");
 
 	TaskHandle handle;
-	while (myReadyQueue.try_dequeue(handle))
+	while (InternalTryDequeue(handle))
 	{
-		std::atomic_ref(myReadyQueueSize).fetch_sub(1, std::memory_order_acq_rel);
 		InternalCall(handle);
-		InternalPurgeDeletionQueue();
+
+		// also between tasks, so that a saturated executor (whose workers never go idle) keeps reporting
+		InternalPlotStats();
 	}
 }
 
-void TaskExecutor::InternalPurgeDeletionQueue()
+TaskExecutor::WorkerCounters& TaskExecutor::InternalCounters() noexcept
 {
-	ZoneScopedN("TaskExecutor::InternalPurgeDeletionQueue");
+	using namespace taskexecutor;
 
-	static thread_local std::vector<TaskHandle> nextDeletionQueue;
-	nextDeletionQueue.reserve(std::max(myDeletionQueue.size_approx(), nextDeletionQueue.size()));
-	nextDeletionQueue.clear();
+	return tlWorkerContext.executor == this ? *myCounters[tlWorkerContext.index] : *myCounters.back();
+}
 
-	TaskHandle handle;
-	while (myDeletionQueue.try_dequeue(handle))
-		if (!InternalTryDelete(handle))
-			nextDeletionQueue.emplace_back(handle);
+int64_t TaskExecutor::InternalNow() noexcept
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TaskExecutor::InternalRecord(Histogram& histogram, int64_t nanoseconds) noexcept
+{
+	auto bucket = std::min<std::size_t>(
+		std::bit_width(static_cast<uint64_t>(std::max<int64_t>(nanoseconds, 0))),
+		TaskExecutorHistogram::kBucketCount - 1);
+
+	histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+TaskExecutorStats TaskExecutor::GetStats() const
+{
+	ZoneScopedN("TaskExecutor::GetStats");
+
+	auto load = [](const std::atomic<uint64_t>& counter) { return counter.load(std::memory_order_relaxed); };
+
+	TaskExecutorStats stats;
+	stats.workers.resize(myCounters.size());
+
+	for (std::size_t workerIt = 0; workerIt < myCounters.size(); workerIt++)
+	{
+		const auto& counters = *myCounters[workerIt];
+		auto& worker = stats.workers[workerIt];
+
+		worker.tasksExecuted = load(counters.tasksExecuted);
+		worker.tasksCancelled = load(counters.tasksCancelled);
+		worker.steals = load(counters.steals);
+		worker.idleNanoseconds = load(counters.idleNanoseconds);
+		std::ranges::transform(counters.submitToStart, worker.submitToStart.buckets.begin(), load);
+		std::ranges::transform(counters.startToFinish, worker.startToFinish.buckets.begin(), load);
+
+		if (workerIt < myWorkerQueues.size())
+			for (const auto& queue : *myWorkerQueues[workerIt])
+				worker.queueDepth += queue.SizeApprox();
+	}
+
+	for (const auto& queues : myReadyQueues)
+		for (uint8_t priorityIt = 0; priorityIt < kTaskPriorityCount; priorityIt++)
+			stats.readyQueueDepth[priorityIt] += (*queues)[priorityIt].size_approx();
+
+	stats.taskPool = GetTaskPoolStats();
+
+	return stats;
+}
+
+void TaskExecutor::InternalPlotStats()
+{
+	auto now = InternalNow();
+
+	// cheap early out, since this runs after every task
+	if (now - myStatsPlotTime.load(std::memory_order_relaxed) < kStatsPlotInterval)
+		return;
+
+	std::unique_lock lock(myStatsPlotMutex, std::try_to_lock);
+
+	if (!lock)
+		return;
+
+	auto elapsed = now - myStatsPlotTime.load(std::memory_order_relaxed);
+
+	if (elapsed < kStatsPlotInterval)
+		return;
+
+	ZoneScopedN("TaskExecutor::InternalPlotStats");
+
+	auto stats = GetStats();
+	auto total = stats.Total();
+	auto delta = total;
+	delta -= myStatsPlotTotal;
+
+	auto readyQueueDepth = std::accumulate(stats.readyQueueDepth.begin(), stats.readyQueueDepth.end(), total.queueDepth);
+	auto idle = static_cast<double>(delta.idleNanoseconds) / static_cast<double>(elapsed * static_cast<int64_t>(myThreads.size()));
+
+	TracyPlot("TaskExecutor ready queue depth", static_cast<int64_t>(readyQueueDepth));
+	TracyPlot("TaskExecutor tasks executed", static_cast<int64_t>(delta.tasksExecuted));
+	TracyPlot("TaskExecutor tasks cancelled", static_cast<int64_t>(delta.tasksCancelled));
+	TracyPlot("TaskExecutor steals", static_cast<int64_t>(delta.steals));
+	TracyPlot("TaskExecutor idle (%)", std::min(idle, 1.0) * 100.0);
+	TracyPlot("TaskExecutor submit to start p50 (us)", static_cast<double>(delta.submitToStart.Percentile(0.5)) * 1e-3);
+	TracyPlot("TaskExecutor submit to start p99 (us)", static_cast<double>(delta.submitToStart.Percentile(0.99)) * 1e-3);
+	TracyPlot("TaskExecutor start to finish p50 (us)", static_cast<double>(delta.startToFinish.Percentile(0.5)) * 1e-3);
+	TracyPlot("TaskExecutor start to finish p99 (us)", static_cast<double>(delta.startToFinish.Percentile(0.99)) * 1e-3);
+	TracyPlot("TaskExecutor task pool size", static_cast<int64_t>(stats.taskPool.size));
+	TracyPlot("TaskExecutor task pool capacity", static_cast<int64_t>(stats.taskPool.capacity));
+	TracyPlot("TaskExecutor task pool high water mark", static_cast<int64_t>(stats.taskPool.highWaterMark));
+
+	myStatsPlotTime.store(now, std::memory_order_relaxed);
+	myStatsPlotTotal = total;
+}
+
+void TaskExecutor::InternalTraceEvent(uint64_t taskId, TaskExecutorTraceEventType type)
+{
+	using namespace taskexecutor;
+
+	auto thread = tlWorkerContext.executor == this ? tlWorkerContext.index : static_cast<uint32_t>(myThreads.size());
+
+	auto& trace = *myTrace;
+	std::unique_lock lock(trace.mutex);
+
+	switch (myTraceMode.load(std::memory_order_relaxed))
+	{
+	case kTraceRecording:
+		trace.trace.events.emplace_back(TaskExecutorTraceEvent{.task = taskId, .thread = thread, .type = type});
+		break;
+	case kTraceReplaying:
+	{
+		auto& pending = type == TaskExecutorTraceEventType::kStart ? trace.pendingStarts : trace.pendingFinishes;
+		auto pendingIt = pending.find(taskId);
+		if (pendingIt == pending.end() || pendingIt->second.empty())
+		{
+			trace.divergences++;
+		}
+		else
+		{
+			trace.eventsDone[pendingIt->second.front()] = true;
+			pendingIt->second.pop_front();
+		}
+
+		if (type == TaskExecutorTraceEventType::kStart)
+			trace.running[taskId]++;
+		else if (auto runningIt = trace.running.find(taskId); runningIt != trace.running.end() && --runningIt->second == 0)
+			trace.running.erase(runningIt);
+
+		InternalReplayAdvance();
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void TaskExecutor::InternalReplayAdvance()
+{
+	auto& trace = *myTrace;
+	const auto& events = trace.trace.events;
+	auto now = InternalNow();
+	auto cursor = trace.cursor;
+	auto stalled = cursor < events.size() && !trace.eventsDone[cursor] && now - trace.progressTime >= kReplayStallTimeout;
+	std::size_t skipped = 0;
+
+	while (trace.cursor < events.size())
+	{
+		if (!trace.eventsDone[trace.cursor])
+		{
+			if (!stalled)
+				break;
+
+			// a stalled replay skips ahead to the first event it can still make progress on
+			const auto& event = events[trace.cursor];
+			if (event.type == TaskExecutorTraceEventType::kStart ? trace.held.contains(event.task) : trace.running.contains(event.task))
+				break;
+
+			auto& pending = event.type == TaskExecutorTraceEventType::kStart ? trace.pendingStarts : trace.pendingFinishes;
+			auto& indices = pending[event.task];
+			ASSERT(!indices.empty() && indices.front() == trace.cursor);
+			indices.pop_front();
+
+			trace.eventsDone[trace.cursor] = true;
+			trace.divergences++;
+			skipped++;
+		}
+
+		trace.cursor++;
+	}
+
+	if (skipped > 0)
+	{
+		LOG_ERROR("Task replay stalled at event {}, skipped {} events", cursor, skipped);
+	}
+
+	if (trace.cursor != cursor)
+		trace.progressTime = now;
+}
+
+bool TaskExecutor::InternalReplayTryDequeue(TaskHandle& handle, TaskPriority maxPriority)
+{
+	ZoneScopedN("TaskExecutor::InternalReplayTryDequeue");
+
+	using namespace taskexecutor;
+
+	auto thread = tlWorkerContext.executor == this ? tlWorkerContext.index : static_cast<uint32_t>(myThreads.size());
+
+	auto& trace = *myTrace;
+	std::unique_lock lock(trace.mutex);
+
+	// a task starts on the thread that ran it in the trace. if that thread does not pick it up in time (e.g. a thread outside
+	// of the pool that is blocked on something else), or the trace was recorded with another thread count, any thread may.
+	auto isOwner = [this, &trace, thread](const TaskExecutorTraceEvent& event)
+	{
+		return event.thread == thread ||
+			trace.trace.threadCount != myThreads.size() ||
+			InternalNow() - trace.progressTime >= kReplayStallTimeout;
+	};
+
+	while (true)
+	{
+		const auto& events = trace.trace.events;
+
+		if (trace.cursor < events.size() && events[trace.cursor].type == TaskExecutorTraceEventType::kStart && isOwner(events[trace.cursor]))
+		{
+			if (auto heldIt = trace.held.find(events[trace.cursor].task);
+				heldIt != trace.held.end() && core::detail::InternalHandleToState(heldIt->second)->priority <= maxPriority)
+			{
+				handle = heldIt->second;
+				trace.held.erase(heldIt);
+				trace.heldCount.store(trace.held.size(), std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		lock.unlock();
+
+		TaskHandle candidate;
+		bool dequeued = false;
+		for (uint8_t priorityIt = 0; priorityIt <= maxPriority && !dequeued; priorityIt++)
+			dequeued = InternalTryDequeue(candidate, static_cast<TaskPriority>(priorityIt));
+
+		lock.lock();
+
+		if (!dequeued)
+		{
+			InternalReplayAdvance();
+			return false;
+		}
+
+		auto taskId = core::detail::InternalHandleToState(candidate)->traceId;
+		auto pendingIt = trace.pendingStarts.find(taskId);
+
+		// tasks that are not in the trace are not held back, and neither are the ones whose turn it is on this thread
+		if (pendingIt == trace.pendingStarts.end() || pendingIt->second.empty() ||
+			(pendingIt->second.front() == trace.cursor && isOwner(events[trace.cursor])))
+		{
+			handle = candidate;
+			return true;
+		}
+
+		if (!trace.held.emplace(taskId, candidate).second)
+		{
+			// duplicate id, e.g. tasks created concurrently by several threads outside of the pool
+			handle = candidate;
+			return true;
+		}
+
+		trace.heldCount.store(trace.held.size(), std::memory_order_relaxed);
+	}
+}
+
+void TaskExecutor::StartRecording()
+{
+	ZoneScopedN("TaskExecutor::StartRecording");
+
+	ENSUREF(myTraceMode.load(std::memory_order_acquire) == kTraceOff, "Executor is already recording or replaying!");
+
+	if (!myTrace)
+		myTrace = std::make_unique<TraceState>();
+
+	std::unique_lock lock(myTrace->mutex);
+
+	myTrace->trace = TaskExecutorTrace{.threadCount = static_cast<uint32_t>(myThreads.size()), .events = {}};
+	core::detail::InternalExchangeTraceParent({});
+	myTraceMode.store(kTraceRecording, std::memory_order_release);
+}
+
+TaskExecutorTrace TaskExecutor::StopRecording()
+{
+	ZoneScopedN("TaskExecutor::StopRecording");
+
+	ENSUREF(myTraceMode.load(std::memory_order_acquire) == kTraceRecording, "Executor is not recording!");
+
+	std::unique_lock lock(myTrace->mutex);
+
+	myTraceMode.store(kTraceOff, std::memory_order_release);
 
-	myDeletionQueue.enqueue_bulk(nextDeletionQueue.begin(), nextDeletionQueue.size());
+	return std::exchange(myTrace->trace, {});
+}
+
+void TaskExecutor::StartReplay(TaskExecutorTrace&& trace)
+{
+	ZoneScopedN("TaskExecutor::StartReplay");
+
+	ENSUREF(myTraceMode.load(std::memory_order_acquire) == kTraceOff, "Executor is already recording or replaying!");
+
+	if (!myTrace)
+		myTrace = std::make_unique<TraceState>();
+
+	std::unique_lock lock(myTrace->mutex);
+
+	auto& state = *myTrace;
+	state.trace = std::forward<TaskExecutorTrace>(trace);
+	state.eventsDone.assign(state.trace.events.size(), false);
+	state.cursor = 0;
+	state.pendingStarts.clear();
+	state.pendingFinishes.clear();
+	state.running.clear();
+	state.held.clear();
+	state.heldCount.store(0, std::memory_order_relaxed);
+	state.progressTime = InternalNow();
+	state.divergences = 0;
+	core::detail::InternalExchangeTraceParent({});
+
+	for (std::size_t eventIt = 0; eventIt < state.trace.events.size(); eventIt++)
+	{
+		const auto& event = state.trace.events[eventIt];
+		auto& pending = event.type == TaskExecutorTraceEventType::kStart ? state.pendingStarts : state.pendingFinishes;
+		pending[event.task].push_back(eventIt);
+	}
+
+	if (state.trace.threadCount != myThreads.size())
+	{
+		LOG_ERROR("Replaying a trace recorded with {} threads on {} threads", state.trace.threadCount, myThreads.size());
+	}
+
+	myTraceMode.store(kTraceReplaying, std::memory_order_release);
+}
+
+uint64_t TaskExecutor::StopReplay()
+{
+	ZoneScopedN("TaskExecutor::StopReplay");
+
+	ENSUREF(myTraceMode.load(std::memory_order_acquire) == kTraceReplaying, "Executor is not replaying!");
+
+	std::vector<TaskHandle> held;
+	uint64_t divergences = 0;
+	{
+		std::unique_lock lock(myTrace->mutex);
+
+		myTraceMode.store(kTraceOff, std::memory_order_release);
+
+		auto& state = *myTrace;
+		for (const auto& [taskId, handle] : state.held)
+			held.push_back(handle);
+
+		state.held.clear();
+		state.heldCount.store(0, std::memory_order_relaxed);
+
+		divergences = state.divergences + std::ranges::count(state.eventsDone, false);
+	}
+
+	if (!held.empty())
+		Submit(held);
+
+	return divergences;
+}
+
+void TaskExecutor::InternalParallelRange(ParallelRangeState& state, std::size_t begin, std::size_t end)
+{
+	using namespace taskexecutor;
+
+	ZoneScopedN("TaskExecutor::InternalParallelRange");
+
+	auto* localQueue = GetLocalQueue(this, state.priority);
+
+	while (end - begin > state.grainSize)
+	{
+		// lazy binary splitting. only hand out more work when the previously split off half has been stolen.
+		// threads outside of the pool can't be stolen from, so they split eagerly.
+		if (localQueue == nullptr || localQueue->Empty())
+		{
+			auto mid = begin + ((end - begin) >> 1);
+			auto [handle, future] = CreateTask([this, &state, mid, end] { InternalParallelRange(state, mid, end); });
+			SetPriority(handle, state.priority);
+			Submit({&handle, 1});
+			end = mid;
+			continue;
+		}
+
+		auto chunkEnd = begin + state.grainSize;
+		state.fn(begin, chunkEnd);
+		state.remaining.fetch_sub(chunkEnd - begin, std::memory_order_release);
+		begin = chunkEnd;
+	}
+
+	state.fn(begin, end);
+
+	// state may go out of scope as soon as remaining reaches zero
+	state.remaining.fetch_sub(end - begin, std::memory_order_release);
+}
+
+void TaskExecutor::InternalParallelFor(std::size_t size, std::size_t grainSize, ParallelRangeFcn fn, TaskPriority priority)
+{
+	if (size == 0)
+		return;
+
+	ParallelRangeState state{.fn = fn, .grainSize = std::max<std::size_t>(grainSize, 1), .priority = priority};
+	state.remaining.store(size, std::memory_order_relaxed);
+
+	InternalParallelRange(state, 0, size);
+
+	// only help with tasks at least as urgent as the range (which includes its own chunks), so that e.g. a background import
+	// never ends up running inside a critical path that is waiting for its range
+	auto tryDequeue = [this, priority](TaskHandle& handle)
+	{
+		if (myTraceMode.load(std::memory_order_acquire) == kTraceReplaying) [[unlikely]]
+			return InternalReplayTryDequeue(handle, priority);
+
+		for (uint8_t priorityIt = 0; priorityIt <= priority; priorityIt++)
+			if (InternalTryDequeue(handle, static_cast<TaskPriority>(priorityIt)))
+				return true;
+
+		return false;
+	};
+
+	TaskHandle handle;
+	while (state.remaining.load(std::memory_order_acquire) != 0)
+	{
+		if (tryDequeue(handle))
+			InternalCall(handle);
+		else
+			std::this_thread::yield();
+	}
 }
 
 void TaskExecutor::JoinOne()
@@ -188,11 +1120,85 @@ void TaskExecutor::JoinOne()
 	ZoneScopedN("TaskExecutor::JoinOne");
 
 	TaskHandle handle;
-	if (myReadyQueue.try_dequeue(handle))
-	{
-		std::atomic_ref(myReadyQueueSize).fetch_sub(1, std::memory_order_acq_rel);
+	if (InternalTryDequeue(handle))
 		InternalCall(handle);
-		InternalPurgeDeletionQueue();
+}
+
+void TaskExecutor::InternalPark(uint32_t threadIndex, const std::stop_token& stopToken)
+{
+	ZoneScopedN("TaskExecutor::InternalPark");
+
+	for (uint32_t spinIt = 0; spinIt < kParkSpinCount; spinIt++)
+	{
+		if (InternalHasReadyTasks() || stopToken.stop_requested())
+			return;
+
+		std::this_thread::yield();
+	}
+
+	auto& state = myParkingSlots[threadIndex]->state;
+
+	state.store(kWorkerParked, std::memory_order_seq_cst);
+	myParkedCount.fetch_add(1, std::memory_order_seq_cst);
+
+	// pairs with the fence in InternalWake. either we see the new task here, or the submitter sees us parked.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (InternalHasReadyTasks() || stopToken.stop_requested())
+	{
+		auto expected = static_cast<uint32_t>(kWorkerParked);
+		if (state.compare_exchange_strong(expected, kWorkerRunning, std::memory_order_acq_rel))
+		{
+			myParkedCount.fetch_sub(1, std::memory_order_relaxed);
+			return;
+		}
+
+		// a submitter got here first and has already taken us off the parked count
+	}
+
+	while (state.load(std::memory_order_acquire) == kWorkerParked)
+		state.wait(kWorkerParked, std::memory_order_acquire);
+
+	state.store(kWorkerRunning, std::memory_order_relaxed);
+}
+
+void TaskExecutor::InternalWake(std::size_t count)
+{
+	using namespace taskexecutor;
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	if (count == 0 || myParkedCount.load(std::memory_order_relaxed) == 0)
+		return;
+
+	ZoneScopedN("TaskExecutor::InternalWake");
+
+	// own node first, then the remote nodes
+	auto node = InternalCurrentNode();
+	auto nodeCount = static_cast<uint32_t>(myNodeWorkers.size());
+
+	for (uint32_t nodeIt = 0; nodeIt < nodeCount; nodeIt++)
+	{
+		const auto& workers = myNodeWorkers[(node + nodeIt) % nodeCount];
+		auto workerCount = static_cast<uint32_t>(workers.size());
+
+		if (workerCount == 0)
+			continue;
+
+		for (uint32_t workerIt = 0, workerOffset = NextStealSeed() % workerCount; workerIt < workerCount; workerIt++)
+		{
+			auto& state = myParkingSlots[workers[(workerIt + workerOffset) % workerCount]]->state;
+			auto expected = static_cast<uint32_t>(kWorkerParked);
+
+			if (!state.compare_exchange_strong(expected, kWorkerNotified, std::memory_order_acq_rel, std::memory_order_relaxed))
+				continue;
+
+			myParkedCount.fetch_sub(1, std::memory_order_relaxed);
+			state.notify_one();
+
+			if (--count == 0 || myParkedCount.load(std::memory_order_relaxed) == 0)
+				return;
+		}
 	}
 }
 
@@ -201,22 +1207,56 @@ void TaskExecutor::InternalThreadMain(uint32_t threadIndex)
 	using namespace taskexecutor;
 
 	gTaskExecutorState.wait(kTaskExecutorInitializing, std::memory_order_acquire);
+
+	auto node = myWorkerNodes[threadIndex];
+
+	tlWorkerContext = WorkerContext{.executor = this, .queues = myWorkerQueues[threadIndex].get(), .index = threadIndex, .node = node};
 	
 	SetThreadName(myThreads[threadIndex], std::format("TaskThread {}", threadIndex).c_str());
+
+	// a topology can name cpus that are offline or outside of our cpuset, in which case the worker just stays unpinned
+	if (auto cpu = myWorkerCpus[threadIndex]; cpu >= 0 && !SetCurrentThreadAffinity(static_cast<uint32_t>(cpu)))
+	{
+		LOG_ERROR("Failed to pin TaskThread {} to cpu {}", threadIndex, cpu);
+	}
+
+	core::detail::InternalSetAllocationNode(node);
 			
-	std::shared_lock lock(myMutex);
+	auto& counters = *myCounters[threadIndex];
 	auto stopToken = myStopSource.get_token();
 
 	while (!stopToken.stop_requested())
-		if (myCV.wait(lock, stopToken,
-			[this]{ return std::atomic_ref(myReadyQueueSize).load(std::memory_order_acquire) > 0; }))
-			InternalProcessReadyQueue();
+	{
+		InternalProcessReadyQueue();
+		InternalPlotStats();
+
+		auto idleStart = InternalNow();
+		InternalPark(threadIndex, stopToken);
+		counters.idleNanoseconds.fetch_add(static_cast<uint64_t>(InternalNow() - idleStart), std::memory_order_relaxed);
+	}
+
+	tlWorkerContext = {};
 }
 
 void TaskExecutor::InternalSubmit(std::span<const TaskHandle> handles)
 {
-	ENSURE(myReadyQueue.enqueue_bulk(handles.data(), handles.size()));
-	std::atomic_ref(myReadyQueueSize).fetch_add(handles.size(), std::memory_order_release);
+	using namespace taskexecutor;
+
+	auto& readyQueues = *myReadyQueues[InternalCurrentNode()];
+	auto submitTime = InternalNow();
+
+	for (auto handle : handles)
+	{
+		Task& task = *core::detail::InternalHandleToPtr(handle);
+		auto priority = task.GetPriority();
+
+		task.InternalState()->submitTime = submitTime;
+
+		if (auto* localQueue = GetLocalQueue(this, priority))
+			localQueue->Push(handle);
+		else
+			ENSURE(readyQueues[priority].enqueue(handle));
+	}
 }
 
 void TaskExecutor::Submit(std::span<const TaskHandle> handles, bool wakeThreads)
@@ -225,11 +1265,6 @@ void TaskExecutor::Submit(std::span<const TaskHandle> handles, bool wakeThreads)
 
 	InternalSubmit(handles);
 	
-	if (auto count = handles.size(); wakeThreads && count > 0)
-	{
-		if (count >= myThreads.size())
-			myCV.notify_all();
-		else while (count--)
-			myCV.notify_one();
-	}
+	if (wakeThreads)
+		InternalWake(handles.size());
 }
\ No newline at end of file
@@ -1,25 +1,112 @@
 #pragma once
 
 #include "task.h"
-#include "upgradablesharedmutex.h"
 #include "utils.h"
+#include "workstealingdeque.h"
 
-#include <condition_variable>
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <ranges>
 #include <vector>
 #include <span>
 #include <stop_token>
+#include <string_view>
 #include <thread>
 
+// logical cpus grouped per NUMA node.
+struct TaskExecutorTopology
+{
+	std::vector<std::vector<uint32_t>> nodes;
+	bool pinThreads = false; // pin each worker thread to a single cpu of its node
+
+	// linux: the cpus in the affinity mask of the process, grouped by node from /sys/devices/system/cpu. other platforms: a single node holding all cpus.
+	[[nodiscard]] static TaskExecutorTopology FromSystem();
+
+	// nodes are separated by ';' and hold linux style cpu lists, e.g. "0-7,16-23;8-15,24-31". returns an empty topology on errors.
+	[[nodiscard]] static TaskExecutorTopology Parse(std::string_view spec);
+};
+
+// log2 bucketed durations. bucket i holds durations in [2^(i-1), 2^i) nanoseconds, the last bucket also holds everything longer.
+struct TaskExecutorHistogram
+{
+	static constexpr std::size_t kBucketCount = 32;
+
+	[[nodiscard]] uint64_t Count() const noexcept;
+	// upper bound (in nanoseconds) of the bucket holding the given fraction (0..1) of all samples
+	[[nodiscard]] uint64_t Percentile(double fraction) const noexcept;
+
+	TaskExecutorHistogram& operator+=(const TaskExecutorHistogram& other) noexcept;
+	TaskExecutorHistogram& operator-=(const TaskExecutorHistogram& other) noexcept;
+
+	std::array<uint64_t, kBucketCount> buckets{};
+};
+
+struct TaskExecutorWorkerStats
+{
+	uint64_t tasksExecuted = 0;
+	uint64_t tasksCancelled = 0; // dropped without running, see SetCancellationToken
+	uint64_t steals = 0;
+	uint64_t idleNanoseconds = 0; // time spent blocked waiting for work
+	std::size_t queueDepth = 0; // tasks in the workers local deques when the snapshot was taken
+	TaskExecutorHistogram submitToStart; // only tasks that went through Submit, not the ones run directly by Call
+	TaskExecutorHistogram startToFinish;
+
+	TaskExecutorWorkerStats& operator+=(const TaskExecutorWorkerStats& other) noexcept;
+	TaskExecutorWorkerStats& operator-=(const TaskExecutorWorkerStats& other) noexcept;
+};
+
+// counters are cumulative since the executor was created. queue depths are sampled when the snapshot is taken.
+struct TaskExecutorStats
+{
+	std::vector<TaskExecutorWorkerStats> workers; // one per worker thread, followed by one shared by all threads outside of the pool
+	std::array<std::size_t, kTaskPriorityCount> readyQueueDepth{}; // ready queues of all nodes, per priority
+	TaskPoolStats taskPool; // the (global) task pool. its high water mark is what the taskPoolCapacity of the executor should cover
+
+	[[nodiscard]] TaskExecutorWorkerStats Total() const noexcept;
+};
+
+enum class TaskExecutorTraceEventType : uint8_t
+{
+	kStart,
+	kFinish
+};
+
+struct TaskExecutorTraceEvent
+{
+	uint64_t task = 0; // TaskState::traceId
+	uint32_t thread = 0; // worker index, or the worker count for threads outside of the pool
+	TaskExecutorTraceEventType type = TaskExecutorTraceEventType::kStart;
+};
+
+// the order in which tasks started and finished on each thread, as a single totally ordered log.
+// task ids only depend on which task created them (and in what order), so they match between runs as long as every task,
+// and the thread(s) outside of the pool, create their tasks in the same order. serializable with zpp::bits, e.g. file::SaveObject.
+struct TaskExecutorTrace
+{
+	uint32_t threadCount = 0;
+	std::vector<TaskExecutorTraceEvent> events;
+};
+
 class TaskExecutor
 {
 public:
-	explicit TaskExecutor(uint32_t threadCount);
+	// taskPoolCapacity is the number of tasks that can be in flight before the (global) task pool needs to grow.
+	// worker threads are distributed round robin over the topology nodes. each node gets its own set of ready queues, workers steal
+	// from their own node first, and tasks created on a worker are allocated from task pool segments owned by that workers node.
+	// an empty topology puts all (unpinned) workers in a single node.
+	explicit TaskExecutor(
+		uint32_t threadCount,
+		uint32_t taskPoolCapacity = kTaskPoolDefaultCapacity,
+		const TaskExecutorTopology& topology = {});
 	~TaskExecutor();
 
 	// wait for task to finish while helping out processing the thread pools ready queue
-	// as soon as the task is ready, the function will stop processing the ready queue and return
+	// as soon as the task is ready, the function will stop processing the ready queue and return. returns std::nullopt if the task was cancelled
 	template <typename R>
 	[[maybe_unused]] std::optional<typename Future<R>::value_t> Join(Future<R>&& future);
 
@@ -31,34 +118,167 @@ public:
 	void Call(TaskHandle handle, Params&&... params) { InternalCall(handle, params...); }
 
 	// async call. task + dependency chain(s) will be executed in thread pool.
+	// wakes (at most) one parked worker per task, preferring workers on the callers node.
 	// if wakeThreads is false, the task will be enqueued but not executed until it is picked up by a running thread.
+	// when called from one of the pools worker threads, the tasks are pushed onto that workers local deque (where idle workers can steal them),
+	// otherwise they are pushed onto the global ready queue. each task is placed in the lane matching its TaskPriority.
 	void Submit(std::span<const TaskHandle> handles, bool wakeThreads = true);
 
+	// blocking call in current thread. calls fn for each element in range, in parallel on the thread pool.
+	// the range is split lazily: a thread only splits off (stealable) work when its local deque has run dry, never below grainSize elements.
+	// the calling thread processes a part of the range itself and then helps out with ready tasks of at least the given priority until the whole range is done.
+	template <std::ranges::random_access_range R, typename F>
+	requires std::ranges::sized_range<R> && std::invocable<F&, std::ranges::range_reference_t<R>>
+	void ParallelFor(R&& range, std::size_t grainSize, F&& fn, TaskPriority priority = kTaskPriorityNormal);
+
+	// like ParallelFor, but returns reduce(... reduce(identity, map(element)) ...) over all elements.
+	// reduce needs to be associative and commutative, since chunks are combined in completion order.
+	template <std::ranges::random_access_range R, typename T, typename Map, typename Reduce>
+	requires std::ranges::sized_range<R>
+	[[nodiscard]] T ParallelReduce(R&& range, std::size_t grainSize, T identity, Map&& map, Reduce&& reduce, TaskPriority priority = kTaskPriorityNormal);
+
+	// logs every task start and finish until StopRecording is called. meant for debugging, all threads serialize on a single lock while recording.
+	// StartRecording and StartReplay restart the task id sequence of the calling thread, so call them from the thread that creates the root tasks.
+	void StartRecording();
+	[[nodiscard]] TaskExecutorTrace StopRecording();
+
+	// forces the interleaving of a recorded trace: a task taken from the ready queues is held back until every event before its start event
+	// in the trace has happened, and then handed to the worker that started it in the trace. tasks that are not in the trace run as soon as
+	// they are dequeued. with a different thread count than the trace was recorded with, only the order is kept. a start event that has not been
+	// matched within kReplayStallTimeout (e.g. since the program took a different path) is skipped, so a diverging replay degrades instead of hanging.
+	// call with no tasks in flight. StopReplay releases any held back tasks and returns the number of events that did not match the trace.
+	void StartReplay(TaskExecutorTrace&& trace);
+	[[maybe_unused]] uint64_t StopReplay();
+
+	// lock free snapshot of the per worker counters. the same counters are published as Tracy plots every kStatsPlotInterval, by whichever worker
+	// finishes a task or goes idle first after it has passed.
+	[[nodiscard]] TaskExecutorStats GetStats() const;
+
 private:
+	using Histogram = std::array<std::atomic<uint64_t>, TaskExecutorHistogram::kBucketCount>;
+	
+	// only written by the owning worker, except for the last one which is shared by all threads outside of the pool
+	struct alignas(std_extra::hardware_destructive_interference_size) WorkerCounters
+	{
+		std::atomic<uint64_t> tasksExecuted{0};
+		std::atomic<uint64_t> tasksCancelled{0};
+		std::atomic<uint64_t> steals{0};
+		std::atomic<uint64_t> idleNanoseconds{0};
+		Histogram submitToStart{};
+		Histogram startToFinish{};
+	};
+
+	[[nodiscard]] WorkerCounters& InternalCounters() noexcept;
+	[[nodiscard]] static int64_t InternalNow() noexcept;
+	static void InternalRecord(Histogram& histogram, int64_t nanoseconds) noexcept;
+	void InternalPlotStats();
+
+#if defined(__cpp_lib_function_ref) && __cpp_lib_function_ref >= 202306L
+	using ParallelRangeFcn = std::function_ref<void(std::size_t, std::size_t)>;
+#else
+	using ParallelRangeFcn = tl::function_ref<void(std::size_t, std::size_t)>;
+#endif
+	struct ParallelRangeState
+	{
+		ParallelRangeFcn fn;
+		std::size_t grainSize = 1;
+		TaskPriority priority = kTaskPriorityNormal;
+		alignas(std_extra::hardware_destructive_interference_size) std::atomic<std::size_t> remaining{0};
+	};
+
+	void InternalParallelFor(std::size_t size, std::size_t grainSize, ParallelRangeFcn fn, TaskPriority priority);
+	void InternalParallelRange(ParallelRangeState& state, std::size_t begin, std::size_t end);
+
 	template <typename... Params>
 	void InternalCall(TaskHandle handle, Params&&... params);
 
 	void InternalSubmit(std::span<const TaskHandle> handles);
 
-	[[nodiscard]] static bool InternalTryDelete(TaskHandle handle);
+	[[nodiscard]] bool InternalTryDequeue(TaskHandle& handle);
+	[[nodiscard]] bool InternalTryDequeue(TaskHandle& handle, TaskPriority priority);
+	[[nodiscard]] bool InternalTrySteal(TaskHandle& handle, TaskPriority priority, uint32_t node);
+	[[nodiscard]] bool InternalHasReadyTasks() const noexcept;
+	[[nodiscard]] uint32_t InternalCurrentNode() const noexcept;
+
+	static void InternalDelete(Task& task, TaskHandle handle);
 
 	void InternalScheduleAdjacent(Task& task);
+	void InternalScheduleAwaiters(TaskHandle handle);
 
 	void InternalProcessReadyQueue();
 	template <typename R>
 	[[nodiscard]] std::optional<typename Future<R>::value_t> InternalProcessReadyQueue(Future<R>&& future);
 
-	void InternalPurgeDeletionQueue();
+	// idle workers spin for a while, then park on their own slot until a submitter hands them a wake up
+	enum ParkingState : uint32_t
+	{
+		kWorkerRunning = 0,
+		kWorkerParked = 1,
+		kWorkerNotified = 2
+	};
+	struct alignas(std_extra::hardware_destructive_interference_size) ParkingSlot
+	{
+		std::atomic<uint32_t> state{kWorkerRunning};
+	};
+	static constexpr uint32_t kParkSpinCount = 64;
+
+	enum TraceMode : uint8_t
+	{
+		kTraceOff = 0,
+		kTraceRecording = 1,
+		kTraceReplaying = 2
+	};
+	struct TraceState
+	{
+		std::mutex mutex;
+		TaskExecutorTrace trace;
+		// replay only
+		std::vector<bool> eventsDone;
+		std::size_t cursor = 0; // first event that has not happened yet
+		UnorderedMap<uint64_t, std::deque<std::size_t>> pendingStarts; // event indices per task id, in trace order
+		UnorderedMap<uint64_t, std::deque<std::size_t>> pendingFinishes;
+		UnorderedMap<uint64_t, uint32_t> running; // tasks that have started, but not finished
+		UnorderedMap<uint64_t, TaskHandle> held; // tasks dequeued before their turn
+		std::atomic<std::size_t> heldCount{0};
+		int64_t progressTime = 0;
+		uint64_t divergences = 0;
+	};
+	static constexpr int64_t kReplayStallTimeout = 1'000'000'000; // nanoseconds
+
+	void InternalTraceEvent(uint64_t taskId, TaskExecutorTraceEventType type);
+	// only starts tasks at least as urgent as maxPriority, e.g. for a thread waiting on a range of that priority
+	[[nodiscard]] bool InternalReplayTryDequeue(TaskHandle& handle, TaskPriority maxPriority = kTaskPriorityBackground);
+	void InternalReplayAdvance(); // myTrace->mutex needs to be locked
+
+	void InternalPark(uint32_t threadIndex, const std::stop_token& stopToken);
+	void InternalWake(std::size_t count);
 
 	void InternalThreadMain(uint32_t threadIndex);
 
 	std::vector<std::jthread> myThreads;
 	std::stop_source myStopSource;
-	UpgradableSharedMutex myMutex;
-	std::condition_variable_any myCV;
-	mutable ConcurrentQueue<TaskHandle> myReadyQueue;
-	uint64_t myReadyQueueSize = 0;
-	mutable ConcurrentQueue<TaskHandle> myDeletionQueue;
+	std::vector<std::unique_ptr<ParkingSlot>> myParkingSlots; // per worker
+	alignas(std_extra::hardware_destructive_interference_size) std::atomic<uint32_t> myParkedCount{0};
+	// max number of higher priority tasks a thread will dequeue before trying the background lane first
+	static constexpr uint32_t kBackgroundStarvationLimit = 64;
+
+	using ReadyQueues = std::array<ConcurrentQueue<TaskHandle>, kTaskPriorityCount>;
+	using WorkerQueues = std::array<WorkStealingDeque<TaskHandle>, kTaskPriorityCount>;
+
+	std::vector<std::unique_ptr<ReadyQueues>> myReadyQueues; // per node. only used for tasks submitted from outside of the pools worker threads
+	std::vector<std::unique_ptr<WorkerQueues>> myWorkerQueues;
+	std::vector<std::vector<uint32_t>> myNodeWorkers; // worker indices per node
+	std::vector<uint32_t> myWorkerNodes;
+	std::vector<int64_t> myWorkerCpus; // -1 if not pinned
+	std::vector<uint32_t> myCpuNodes; // used to pick the ready queues for tasks submitted from outside of the pool
+	std::vector<std::unique_ptr<WorkerCounters>> myCounters; // one per worker + one for threads outside of the pool
+	uint32_t myTaskPoolCapacity = 0; // as requested, to report when the pool had to grow past it
+	static constexpr int64_t kStatsPlotInterval = 10'000'000; // nanoseconds
+	std::mutex myStatsPlotMutex;
+	std::atomic<int64_t> myStatsPlotTime = 0; // written with myStatsPlotMutex held
+	TaskExecutorWorkerStats myStatsPlotTotal; // protected by myStatsPlotMutex
+	std::atomic<TraceMode> myTraceMode{kTraceOff};
+	std::unique_ptr<TraceState> myTrace;
 };
 
 #include "taskexecutor.inl"
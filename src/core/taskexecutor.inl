@@ -1,6 +1,8 @@
 #include "profiling.h"
 
 #include <atomic>
+#include <functional>
+#include <mutex>
 
 template <typename R>
 std::optional<typename Future<R>::value_t> TaskExecutor::Join(Future<R>&& future)
@@ -19,12 +21,13 @@ std::optional<typename Future<R>::value_t> TaskExecutor::InternalProcessReadyQue
 		return std::nullopt;
 
 	TaskHandle handle;
-	while (!future.IsReady() && myReadyQueue.try_dequeue(handle))
-	{
-		std::atomic_ref(myReadyQueueSize).fetch_sub(1, std::memory_order_acq_rel);
+	while (!future.IsReady() && InternalTryDequeue(handle))
 		InternalCall(handle);
-		InternalPurgeDeletionQueue();
-	}
+
+	future.Wait();
+
+	if (future.IsCancelled())
+		return std::nullopt;
 
 	return std::make_optional(future.Get());
 }
@@ -35,11 +38,94 @@ void TaskExecutor::InternalCall(TaskHandle handle, Params&&... params)
 	ZoneScopedN("TaskExecutor::InternalCall");
 
 	Task& task = *core::detail::InternalHandleToPtr(handle);
-	auto& state = *std::atomic_load(&task.InternalState());
+	auto& state = *task.InternalState();
 	
 	ENSURE(std::atomic_ref(state.latch).load(std::memory_order_relaxed) == 1);
 
-	task(params...);
+	auto& counters = InternalCounters();
+	auto startTime = InternalNow();
+
+	if (state.submitTime != 0)
+		InternalRecord(counters.submitToStart, startTime - state.submitTime);
+
+	if (task.InternalIsCancelled()) [[unlikely]]
+	{
+		// dropped without running. the latch is released just like Task::operator() does, leaving the return value default constructed
+		std::atomic_ref(state.cancelled).store(1, std::memory_order_relaxed);
+
+		auto latch = std::atomic_ref(state.latch);
+		latch.fetch_sub(1, std::memory_order_release);
+		latch.notify_all();
+
+		counters.tasksCancelled.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		auto traceId = state.traceId;
+		auto traceParent = core::detail::InternalExchangeTraceParent({.id = traceId});
+		auto tracing = myTraceMode.load(std::memory_order_acquire) != kTraceOff;
+
+		if (tracing) [[unlikely]]
+			InternalTraceEvent(traceId, TaskExecutorTraceEventType::kStart);
+
+		task(params...);
+
+		if (tracing) [[unlikely]]
+			InternalTraceEvent(traceId, TaskExecutorTraceEventType::kFinish);
+
+		core::detail::InternalExchangeTraceParent(traceParent);
+
+		InternalRecord(counters.startToFinish, InternalNow() - startTime);
+		counters.tasksExecuted.fetch_add(1, std::memory_order_relaxed);
+	}
+
 	InternalScheduleAdjacent(task);
-	myDeletionQueue.enqueue(handle);
+	InternalScheduleAwaiters(handle);
+	InternalDelete(task, handle);
+}
+
+template <std::ranges::random_access_range R, typename F>
+requires std::ranges::sized_range<R> && std::invocable<F&, std::ranges::range_reference_t<R>>
+void TaskExecutor::ParallelFor(R&& range, std::size_t grainSize, F&& fn, TaskPriority priority)
+{
+	ZoneScopedN("TaskExecutor::ParallelFor");
+
+	auto first = std::ranges::begin(range);
+
+	InternalParallelFor(
+		static_cast<std::size_t>(std::ranges::size(range)),
+		grainSize,
+		[&first, &fn](std::size_t begin, std::size_t end)
+		{
+			for (auto it = begin; it < end; it++)
+				std::invoke(fn, first[static_cast<std::ranges::range_difference_t<R>>(it)]);
+		},
+		priority);
+}
+
+template <std::ranges::random_access_range R, typename T, typename Map, typename Reduce>
+requires std::ranges::sized_range<R>
+T TaskExecutor::ParallelReduce(R&& range, std::size_t grainSize, T identity, Map&& map, Reduce&& reduce, TaskPriority priority)
+{
+	ZoneScopedN("TaskExecutor::ParallelReduce");
+
+	auto first = std::ranges::begin(range);
+	std::mutex mutex;
+	T result = identity;
+
+	InternalParallelFor(
+		static_cast<std::size_t>(std::ranges::size(range)),
+		grainSize,
+		[&first, &identity, &map, &reduce, &mutex, &result](std::size_t begin, std::size_t end)
+		{
+			T partial = identity;
+			for (auto it = begin; it < end; it++)
+				partial = std::invoke(reduce, std::move(partial), std::invoke(map, first[static_cast<std::ranges::range_difference_t<R>>(it)]));
+
+			std::scoped_lock lock(mutex);
+			result = std::invoke(reduce, std::move(result), std::move(partial));
+		},
+		priority);
+
+	return result;
 }
@@ -0,0 +1,135 @@
+#include "taskgraph.h"
+#include "taskexecutor.h"
+
+#include <limits>
+
+void TaskGraph::AddEdge(NodeHandle a, NodeHandle b)
+{
+	ENSURE(a < myNodes.size());
+	ENSURE(b < myNodes.size());
+	ENSURE(a != b);
+
+	myEdges.emplace_back(a, b);
+	myIsDirty = true;
+}
+
+bool TaskGraph::Validate()
+{
+	ZoneScopedN("TaskGraph::Validate");
+
+	if (!myIsDirty)
+		return myIsValid;
+
+	const auto nodeCount = myNodes.size();
+
+	myEdgeOffsets.assign(nodeCount + 1, 0U);
+	myEdgeTargets.resize(myEdges.size());
+	myInDegrees.assign(nodeCount, 0U);
+	myRoots.clear();
+	myLeaves.clear();
+
+	for (const auto& [a, b] : myEdges)
+	{
+		myEdgeOffsets[a + 1]++;
+		myInDegrees[b]++;
+	}
+
+	for (std::size_t nodeIt = 0; nodeIt < nodeCount; nodeIt++)
+		myEdgeOffsets[nodeIt + 1] += myEdgeOffsets[nodeIt];
+
+	{
+		std::vector<uint32_t> cursors(myEdgeOffsets.begin(), myEdgeOffsets.end() - 1);
+		for (const auto& [a, b] : myEdges)
+			myEdgeTargets[cursors[a]++] = b;
+	}
+
+	// Kahn's algorithm, only used to find cycles - the executor does the actual ordering
+	std::vector<uint32_t> inDegrees(myInDegrees);
+	std::vector<NodeHandle> ready;
+	ready.reserve(nodeCount);
+
+	for (NodeHandle node = 0; node < nodeCount; node++)
+	{
+		// the task latch is a uint16_t that starts at one
+		ENSUREF(myInDegrees[node] < std::numeric_limits<uint16_t>::max(), "Too many incoming edges on node {}!", node);
+
+		if (myInDegrees[node] == 0)
+		{
+			myRoots.push_back(node);
+			ready.push_back(node);
+		}
+
+		if (myEdgeOffsets[node] == myEdgeOffsets[node + 1])
+			myLeaves.push_back(node);
+	}
+
+	for (std::size_t readyIt = 0; readyIt < ready.size(); readyIt++)
+	{
+		auto node = ready[readyIt];
+		for (auto edgeIt = myEdgeOffsets[node]; edgeIt < myEdgeOffsets[node + 1]; edgeIt++)
+			if (--inDegrees[myEdgeTargets[edgeIt]] == 0)
+				ready.push_back(myEdgeTargets[edgeIt]);
+	}
+
+	myIsValid = ready.size() == nodeCount;
+	myIsDirty = false;
+
+	return myIsValid;
+}
+
+Future<void> TaskGraph::Submit(TaskExecutor& executor)
+{
+	ZoneScopedN("TaskGraph::Submit");
+
+	ENSUREF(Validate(), "TaskGraph contains a cycle!");
+	ENSUREF(myLeaves.size() < std::numeric_limits<uint16_t>::max(), "Too many leaf nodes!");
+
+	myTaskHandles.clear();
+	myRootHandles.clear();
+
+	// none of the tasks are visible to the executor until the roots are submitted,
+	// so latches and adjacencies can be written directly instead of going through AddDependency
+	for (NodeHandle node = 0; node < myNodes.size(); node++)
+	{
+		auto& [callable, priority] = myNodes[node];
+		auto [handle, future] = CreateTask([&callable] { callable(); });
+
+		auto& state = *core::detail::InternalHandleToState(handle);
+		state.latch = static_cast<uint16_t>(1U + myInDegrees[node]);
+		state.priority = priority;
+
+		myTaskHandles.push_back(handle);
+	}
+
+	auto [doneHandle, doneFuture] = CreateTask([] {});
+	auto& doneState = *core::detail::InternalHandleToState(doneHandle);
+	doneState.latch = static_cast<uint16_t>(1U + myLeaves.size());
+
+	for (NodeHandle node = 0; node < myNodes.size(); node++)
+	{
+		auto& state = *core::detail::InternalHandleToState(myTaskHandles[node]);
+		for (auto edgeIt = myEdgeOffsets[node]; edgeIt < myEdgeOffsets[node + 1]; edgeIt++)
+			core::detail::InternalAddAdjacency(state, myTaskHandles[myEdgeTargets[edgeIt]]);
+	}
+
+	for (auto leaf : myLeaves)
+		core::detail::InternalAddAdjacency(*core::detail::InternalHandleToState(myTaskHandles[leaf]), doneHandle);
+
+	for (auto root : myRoots)
+		myRootHandles.push_back(myTaskHandles[root]);
+
+	if (myRootHandles.empty())
+		myRootHandles.push_back(doneHandle);
+
+	executor.Submit(myRootHandles);
+
+	return std::move(doneFuture);
+}
+
+void TaskGraph::Clear()
+{
+	myNodes.clear();
+	myEdges.clear();
+	myIsValid = false;
+	myIsDirty = true;
+}
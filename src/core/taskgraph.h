@@ -0,0 +1,71 @@
+#pragma once
+
+#include "task.h"
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+class TaskExecutor;
+
+// Records a DAG of nodes and edges once, and instantiates it as tasks as many times as needed (e.g. once per frame).
+// Validation (cycle detection, roots, leaves & initial latches) only runs when the graph has changed since the last Submit,
+// and every instance is wired up in a single pass and started with a single TaskExecutor::Submit of all roots.
+// Node callables are owned by the graph and referenced by the instantiated tasks, so the graph must not be modified
+// or destroyed while an instance is in flight.
+class TaskGraph
+{
+public:
+	using NodeHandle = uint32_t;
+
+	TaskGraph() = default;
+	TaskGraph(const TaskGraph&) = delete;
+	TaskGraph(TaskGraph&&) noexcept = default;
+
+	TaskGraph& operator=(const TaskGraph&) = delete;
+	TaskGraph& operator=(TaskGraph&&) noexcept = default;
+
+	template <typename F>
+	requires std::invocable<F&>
+	[[nodiscard]] NodeHandle AddNode(F&& callable, TaskPriority priority = kTaskPriorityNormal);
+
+	// b will start after a has finished
+	void AddEdge(NodeHandle a, NodeHandle b);
+
+	// returns false if the graph contains a cycle
+	[[nodiscard]] bool Validate();
+
+	// instantiates the graph and submits all of its roots. the returned future is ready when every node has finished.
+	[[nodiscard]] Future<void> Submit(TaskExecutor& executor);
+
+	void Clear();
+
+	[[nodiscard]] std::size_t NodeCount() const noexcept { return myNodes.size(); }
+	[[nodiscard]] std::size_t EdgeCount() const noexcept { return myEdges.size(); }
+
+private:
+	struct Node
+	{
+		std::function<void()> callable;
+		TaskPriority priority = kTaskPriorityNormal;
+	};
+
+	std::vector<Node> myNodes;
+	std::vector<std::pair<NodeHandle, NodeHandle>> myEdges;
+
+	// built by Validate
+	bool myIsValid = false;
+	bool myIsDirty = true;
+	std::vector<uint32_t> myEdgeOffsets; // CSR adjacency, edges of node n are myEdgeTargets[myEdgeOffsets[n]..myEdgeOffsets[n + 1]]
+	std::vector<NodeHandle> myEdgeTargets;
+	std::vector<uint32_t> myInDegrees;
+	std::vector<NodeHandle> myRoots;
+	std::vector<NodeHandle> myLeaves;
+
+	// scratch memory reused between instances
+	std::vector<TaskHandle> myTaskHandles;
+	std::vector<TaskHandle> myRootHandles;
+};
+
+#include "taskgraph.inl"
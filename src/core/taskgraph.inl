@@ -0,0 +1,13 @@
+#include "assert.h"//NOLINT(modernize-deprecated-headers)
+
+template <typename F>
+requires std::invocable<F&>
+TaskGraph::NodeHandle TaskGraph::AddNode(F&& callable, TaskPriority priority)
+{
+	ENSURE(priority < kTaskPriorityCount);
+
+	myNodes.emplace_back(Node{.callable = std::forward<F>(callable), .priority = priority});
+	myIsDirty = true;
+
+	return static_cast<NodeHandle>(myNodes.size() - 1);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "std_extra.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+// Chase-Lev work stealing deque (see "Correct and Efficient Work-Stealing for Weak Memory Models", Le et al. 2013).
+// Push & Pop may only be called from the owning thread, Steal may be called from any thread.
+template <typename T>
+class WorkStealingDeque final
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+	explicit WorkStealingDeque(std::size_t capacity = kDefaultCapacity);
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque(WorkStealingDeque&&) noexcept = delete;
+	~WorkStealingDeque() noexcept;
+
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(WorkStealingDeque&&) noexcept = delete;
+
+	void Push(T value);
+	[[nodiscard]] std::optional<T> Pop() noexcept;
+	[[nodiscard]] std::optional<T> Steal() noexcept;
+
+	[[nodiscard]] std::size_t SizeApprox() const noexcept;
+	[[nodiscard]] bool Empty() const noexcept { return SizeApprox() == 0; }
+
+private:
+	static constexpr std::size_t kDefaultCapacity = 1024;
+
+	struct Buffer
+	{
+		explicit Buffer(std::size_t capacity);
+
+		[[nodiscard]] T Load(int64_t index) const noexcept;
+		void Store(int64_t index, T value) noexcept;
+
+		std::size_t capacity;
+		std::size_t mask;
+		std::unique_ptr<std::atomic<T>[]> elements;//NOLINT(modernize-avoid-c-arrays)
+	};
+
+	[[nodiscard]] Buffer* InternalGrow(Buffer* buffer, int64_t bottom, int64_t top);
+
+	alignas(std_extra::hardware_destructive_interference_size) std::atomic<int64_t> myTop{0};
+	alignas(std_extra::hardware_destructive_interference_size) std::atomic<int64_t> myBottom{0};
+	alignas(std_extra::hardware_destructive_interference_size) std::atomic<Buffer*> myBuffer{nullptr};
+	std::vector<std::unique_ptr<Buffer>> myBuffers; // owner only. retired buffers are kept alive since thieves may still be reading from them.
+};
+
+#include "workstealingdeque.inl"
@@ -0,0 +1,123 @@
+#include "assert.h"//NOLINT(modernize-deprecated-headers)
+
+#include <bit>
+
+template <typename T>
+WorkStealingDeque<T>::Buffer::Buffer(std::size_t capacity)
+	: capacity(capacity)
+	, mask(capacity - 1)
+	, elements(std::make_unique<std::atomic<T>[]>(capacity))//NOLINT(modernize-avoid-c-arrays)
+{
+	ENSUREF(std::has_single_bit(capacity), "Capacity must be a power of two!");
+}
+
+template <typename T>
+T WorkStealingDeque<T>::Buffer::Load(int64_t index) const noexcept
+{
+	return elements[static_cast<std::size_t>(index) & mask].load(std::memory_order_relaxed);
+}
+
+template <typename T>
+void WorkStealingDeque<T>::Buffer::Store(int64_t index, T value) noexcept
+{
+	elements[static_cast<std::size_t>(index) & mask].store(value, std::memory_order_relaxed);
+}
+
+template <typename T>
+WorkStealingDeque<T>::WorkStealingDeque(std::size_t capacity)
+{
+	myBuffer.store(myBuffers.emplace_back(std::make_unique<Buffer>(std::bit_ceil(capacity))).get(), std::memory_order_relaxed);
+}
+
+template <typename T>
+WorkStealingDeque<T>::~WorkStealingDeque() noexcept
+{
+	ASSERT(Empty());
+}
+
+template <typename T>
+typename WorkStealingDeque<T>::Buffer* WorkStealingDeque<T>::InternalGrow(Buffer* buffer, int64_t bottom, int64_t top)
+{
+	auto* grown = myBuffers.emplace_back(std::make_unique<Buffer>(buffer->capacity << 1)).get();
+
+	for (auto index = top; index < bottom; index++)
+		grown->Store(index, buffer->Load(index));
+
+	myBuffer.store(grown, std::memory_order_release);
+
+	return grown;
+}
+
+template <typename T>
+void WorkStealingDeque<T>::Push(T value)
+{
+	auto bottom = myBottom.load(std::memory_order_relaxed);
+	auto top = myTop.load(std::memory_order_acquire);
+	auto* buffer = myBuffer.load(std::memory_order_relaxed);
+
+	if (bottom - top > static_cast<int64_t>(buffer->capacity) - 1)
+		buffer = InternalGrow(buffer, bottom, top);
+
+	buffer->Store(bottom, value);
+
+	std::atomic_thread_fence(std::memory_order_release);
+	myBottom.store(bottom + 1, std::memory_order_relaxed);
+}
+
+template <typename T>
+std::optional<T> WorkStealingDeque<T>::Pop() noexcept
+{
+	auto bottom = myBottom.load(std::memory_order_relaxed) - 1;
+	auto* buffer = myBuffer.load(std::memory_order_relaxed);
+	myBottom.store(bottom, std::memory_order_relaxed);
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	auto top = myTop.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		myBottom.store(bottom + 1, std::memory_order_relaxed);
+		return std::nullopt;
+	}
+
+	auto value = buffer->Load(bottom);
+
+	if (top == bottom)
+	{
+		// last element, race against thieves
+		bool success = myTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		myBottom.store(bottom + 1, std::memory_order_relaxed);
+		if (!success)
+			return std::nullopt;
+	}
+
+	return value;
+}
+
+template <typename T>
+std::optional<T> WorkStealingDeque<T>::Steal() noexcept
+{
+	auto top = myTop.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	auto bottom = myBottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+		return std::nullopt;
+
+	auto* buffer = myBuffer.load(std::memory_order_acquire);
+	auto value = buffer->Load(top);
+
+	if (!myTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return std::nullopt;
+
+	return value;
+}
+
+template <typename T>
+std::size_t WorkStealingDeque<T>::SizeApprox() const noexcept
+{
+	auto bottom = myBottom.load(std::memory_order_relaxed);
+	auto top = myTop.load(std::memory_order_relaxed);
+
+	return static_cast<std::size_t>(std::max<int64_t>(bottom - top, 0));
+}
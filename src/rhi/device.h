@@ -53,6 +53,7 @@ public:
 	[[nodiscard]] operator auto() const noexcept { return myDevice; }//NOLINT(google-explicit-constructor)
 
 	[[nodiscard]] const auto& GetInstance() const noexcept { return myInstance; } // todo: make global?
+	[[nodiscard]] auto& GetConfig() noexcept { return myConfig; }
 	[[nodiscard]] const auto& GetConfig() const noexcept { return myConfig; }
 	[[nodiscard]] auto GetPhysicalDevice() const noexcept
 	{
@@ -4,6 +4,8 @@
 #include "queue.h"
 #include "rhibase.h"
 
+#include <core/file.h>
+
 #include <filesystem>
 #include <memory>
 #include <optional>
@@ -135,4 +137,10 @@ template <GraphicsApi G>
 	std::string_view filePath,
 	std::atomic_uint8_t& progress);
 
+// imports filePath into the asset cache (unless it is already there) without loading it, so it needs no device
+template <GraphicsApi G>
+[[nodiscard]] std::expected<file::Record, std::error_code> CookImage(
+	const std::filesystem::path& filePath,
+	std::atomic_uint8_t& progress);
+
 } // namespace image
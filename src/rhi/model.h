@@ -4,6 +4,7 @@
 #include "device.h"
 #include "rhibase.h"
 
+#include <core/file.h>
 #include <gfx/bounds.h>
 #include <gfx/vertex.h>
 
@@ -54,7 +55,8 @@ private:
 			AllocationHandle<G>,
 			BufferHandle<G>,
 			AllocationHandle<G>,
-			ModelCreateDesc<G>>&& initialData);
+			ModelCreateDesc<G>,
+			bool>&& initialData); // true if the buffers in initialData already are the final, device local, buffers
 
 	Buffer<kVk> myIndexBuffer;
 	Buffer<kVk> myVertexBuffer;
@@ -72,4 +74,10 @@ template <GraphicsApi G>
 	std::atomic_uint8_t& progress,
 	std::shared_ptr<Model<G>> oldModel = nullptr);
 
+// imports filePath into the asset cache (unless it is already there) without loading it, so it needs no device
+template <GraphicsApi G>
+[[nodiscard]] std::expected<file::Record, std::error_code> CookModel(
+	const std::filesystem::path& filePath,
+	std::atomic_uint8_t& progress);
+
 } // namespace model
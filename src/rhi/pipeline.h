@@ -109,6 +109,7 @@ public:
 		PipelineConfiguration<G>&& defaultConfig = {});
 	~Pipeline() override;
 
+	[[nodiscard]] auto& GetConfig() noexcept { return myConfig; }
 	[[nodiscard]] const auto& GetConfig() const noexcept { return myConfig; }
 	[[nodiscard]] auto GetCache() const noexcept { return myCache; }
 	[[nodiscard]] auto GetDescriptorPool() const noexcept { return myDescriptorPool; }
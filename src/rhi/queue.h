@@ -3,6 +3,7 @@
 #include "command.h"
 #include "device.h"
 #include "fence.h"
+#include "queuecompletion.h"
 #include "rhi/capi.h"
 #include "semaphore.h"
 #include "types.h"
@@ -25,8 +26,8 @@ struct QueueDeviceSyncInfo
 	std::vector<uint64_t> waitSemaphoreValues;
 	std::vector<SemaphoreHandle<G>> signalSemaphores;
 	std::vector<uint64_t> signalSemaphoreValues;
-	// These will be passed on and stored internally in the queue to be called after the queue has finished executing the command buffers on the device.
-	// They will then be called and deleted through manually calling the Queue::SubmitCallbacks from the host.
+	// These will be passed on to the QueueCompletionService of the queue, and submitted to the executor
+	// as soon as the queue timeline has reached the timeline value of the submit.
 	std::vector<TaskHandle> callbacks;
 };
 
@@ -93,6 +94,8 @@ struct QueueCreateDesc
 {
 	uint32_t queueIndex = 0UL;
 	uint32_t queueFamilyIndex = 0UL;
+	SemaphoreHandle<G> timeline{}; // timeline semaphore signalled by all submits that carry callbacks
+	QueueCompletionService<G>* completionService = nullptr;
 };
 
 template <GraphicsApi G>
@@ -126,8 +129,6 @@ public:
 	void Execute(uint8_t level, uint64_t timelineValue);
 
 	void WaitIdle() const;
-	
-	bool SubmitCallbacks(TaskExecutor& executor, uint64_t timelineValue) const;
 
 	[[nodiscard]] auto& GetPool() noexcept { return myPools[0]; }
 	[[nodiscard]] const auto& GetPool() const noexcept { return myPools[0]; }
@@ -153,8 +154,6 @@ private:
 	std::vector<QueueSubmitInfo<G>> myPendingSubmits;
 	QueuePresentInfo<G> myPendingPresent{};
 	std::vector<char> myScratchMemory;
-	using TimelineCallbackData = std::tuple<std::vector<TaskHandle>, uint64_t>;
-	mutable ConcurrentQueue<TimelineCallbackData> myTimelineCallbacks;
 
 #if (SPEEDO_PROFILING_LEVEL > 0)
 	void* myProfilingContext = nullptr;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "device.h"
+#include "semaphore.h"
+#include "types.h"
+
+#include <core/task.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+class TaskExecutor;
+
+// Runs GPU completion callbacks (QueueDeviceSyncInfo::callbacks) on a dedicated thread.
+// The thread blocks in a single wait-any on all queue timelines that have pending callbacks,
+// plus a host signalled wake semaphore, and submits each batch to the executor as soon as
+// its timeline value has been reached.
+template <GraphicsApi G>
+class QueueCompletionService final
+{
+public:
+	QueueCompletionService(const std::shared_ptr<Device<G>>& device, TaskExecutor& executor);
+	QueueCompletionService(const QueueCompletionService&) = delete;
+	QueueCompletionService(QueueCompletionService&&) noexcept = delete;
+	~QueueCompletionService();
+
+	QueueCompletionService& operator=(const QueueCompletionService&) = delete;
+	QueueCompletionService& operator=(QueueCompletionService&&) noexcept = delete;
+
+	// callbacks are submitted once timeline has reached timelineValue.
+	void Enqueue(SemaphoreHandle<G> timeline, uint64_t timelineValue, std::vector<TaskHandle>&& callbacks);
+
+	// stops the completion thread and submits all callbacks with signalled timelines on the calling thread.
+	// call after the device is idle, no more callbacks may be enqueued afterwards.
+	void Flush();
+
+private:
+	struct PendingCallbacks
+	{
+		uint64_t timelineValue = 0ULL;
+		std::vector<TaskHandle> callbacks;
+	};
+
+	struct Timeline
+	{
+		SemaphoreHandle<G> semaphore{};
+		std::vector<PendingCallbacks> pending; // sorted on timelineValue
+	};
+
+	struct Registration
+	{
+		SemaphoreHandle<G> timeline{};
+		PendingCallbacks callbacks;
+	};
+
+	void InternalRun(std::stop_token stopToken);
+	void InternalWake();
+	void InternalDrainRegistrations();
+	void InternalSubmitSignaled();
+
+	std::shared_ptr<Device<G>> myDevice;
+	TaskExecutor& myExecutor;
+	Semaphore<G> myWakeSemaphore;
+	uint64_t myWakeValue = 0ULL; // protected by myMutex
+	std::mutex myMutex;
+	std::vector<Registration> myRegistrations; // protected by myMutex
+	std::vector<Timeline> myTimelines; // only accessed by the completion thread (or by Flush once it has been joined)
+	std::vector<SemaphoreHandle<G>> myWaitSemaphores;
+	std::vector<uint64_t> myWaitValues;
+	std::jthread myThread;
+};
@@ -6,6 +6,7 @@
 #include "instance.h"
 #include "pipeline.h"
 #include "queue.h"
+#include "queuecompletion.h"
 #include "renderimageset.h"
 #include "semaphore.h"
 #include "shaders/capi.h"
@@ -38,6 +39,7 @@ public:
 	[[nodiscard]] auto& GetDevice() { return myDevice; }
 	[[nodiscard]] auto& GetInstance() { return myInstance; }
 	[[nodiscard]] auto& GetQueues() { return myQueues; }
+	[[nodiscard]] auto& GetQueueCompletionService() { return *myQueueCompletionService; }
 	[[nodiscard]] auto& GetResources() { return myResources; }
 
 private:
@@ -47,6 +49,7 @@ private:
 	CreateWindowFunc myCreateWindowFunc;
 
 	UnorderedMap<QueueType, QueueTimelineContext<G>> myQueues;
+	std::unique_ptr<QueueCompletionService<G>> myQueueCompletionService; // declared after myQueues so that it is stopped before the timeline semaphores are destroyed
 	std::flat_set<Window<G>, HandleCompareLess<Window<G>, WindowHandle>> myWindows;
 
 	// temp until we have a proper resource manager
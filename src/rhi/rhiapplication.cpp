@@ -3,5 +3,6 @@
 UpgradableSharedMutex RHIApplication::gDrawMutex{};
 std::atomic_uint8_t RHIApplication::gProgress = 0;
 std::atomic_bool RHIApplication::gShowProgress = false;
+CancellationToken RHIApplication::gImportCancellation{};
 bool RHIApplication::gShowAbout = false;
 bool RHIApplication::gShowDemoWindow = false;
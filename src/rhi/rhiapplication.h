@@ -66,6 +66,7 @@ private:
 	static UpgradableSharedMutex gDrawMutex; //NOLINT(readability-identifier-naming)
 	static std::atomic_uint8_t gProgress; //NOLINT(readability-identifier-naming)
 	static std::atomic_bool gShowProgress; //NOLINT(readability-identifier-naming)
+	static CancellationToken gImportCancellation; //NOLINT(readability-identifier-naming)
 	static bool gShowAbout; //NOLINT(readability-identifier-naming)
 	static bool gShowDemoWindow; //NOLINT(readability-identifier-naming)
 };
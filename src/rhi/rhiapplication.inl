@@ -30,6 +30,16 @@ void RHIApplication::InternalOpenFileDialogueAsync(std::string&& resourcePathStr
 		std::move(openFileFuture),
 		loadOp);
 
+	// the file dialogue needs to run on the main thread, but the import itself is bulk work that should not delay frame tasks
+	AddDependency(openFileTask, loadTask);
+	SetPriority(loadTask, kTaskPriorityBackground);
+
+	// a new import supersedes any earlier import that has not started yet
+	if (gImportCancellation)
+		gImportCancellation.Cancel();
+
+	gImportCancellation = CancellationToken::Create();
+	SetCancellationToken(loadTask, gImportCancellation);
+
 	rhi.mainCalls.enqueue(openFileTask);
-	rhi.mainCalls.enqueue(loadTask);
 }
@@ -40,8 +40,12 @@ public:
 		DeviceHandle<G> device,
 		std::span<const SemaphoreHandle<G>> semaphores,
 		std::span<const uint64_t> semaphoreValues,
+		bool waitAll = true,
 		uint64_t timeout = ~0ULL);
 
+	// host side signal of a timeline semaphore. timelineValue must be larger than the current value.
+	void Signal(uint64_t timelineValue) const;
+
 private:
 	Semaphore(
 		const std::shared_ptr<Device<G>>& device,
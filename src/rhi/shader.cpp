@@ -27,6 +27,19 @@ ShaderLoader::ShaderLoader(
 	}
 }
 
+std::string ShaderLoader::InternalGetParametersHash(const SlangConfiguration& config)
+{
+	std::string params, paramsHash;
+	params.append("slang-0.9.3"); // todo: read version from slang header
+	params.append(config.ToString());
+	static constexpr size_t kSha2Size = 32;
+	std::array<uint8_t, kSha2Size> sha2;
+	picosha2::hash256(params.cbegin(), params.cend(), sha2.begin(), sha2.end());
+	picosha2::bytes_to_hex_string(sha2.cbegin(), sha2.cend(), paramsHash);
+
+	return paramsHash;
+}
+
 std::string ShaderLoader::SlangConfiguration::ToString() const
 {
 	std::string entryPointsString;
@@ -4,11 +4,14 @@
 #include "device.h"
 #include "types.h"
 
+#include <core/file.h>
 #include <core/utils.h>
 
+#include <expected>
 #include <map>
 #include <memory>
 #include <string>
+#include <system_error>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -75,16 +78,37 @@ public:
 	ShaderLoader& operator=(const ShaderLoader&) = delete;
 	ShaderLoader& operator=(ShaderLoader&&) noexcept = delete;
 
+	// stops the process if the shaders fail to compile, with the slang diagnostics
 	template <GraphicsApi G>
 	[[nodiscard]] ShaderSet<G> Load(const std::filesystem::path& file, const SlangConfiguration& config);
 
+	// compiles file into the asset cache (unless it is already there) without loading it. compile errors are returned.
+	template <GraphicsApi G>
+	[[nodiscard]] std::expected<file::Record, std::error_code> Cook(const std::filesystem::path& file, const SlangConfiguration& config);
+
 private:
+	template <GraphicsApi G>
+	[[nodiscard]] std::pair<file::LoadFn, file::SaveFn> InternalCreateImportFns(
+		const std::filesystem::path& file, const SlangConfiguration& config, ShaderSet<G>& shaderSet);
+
+	[[nodiscard]] static std::string InternalGetParametersHash(const SlangConfiguration& config);
+
 	std::vector<std::filesystem::path> myIncludePaths;
 	std::vector<DownstreamCompiler> myDownstreamCompilers;
 	std::optional<std::filesystem::path> myIntermediatePath;
 	std::unique_ptr<SlangSession, void (*)(SlangSession*)> myCompilerSession;
 };
 
+namespace shader
+{
+
+// name -> configuration of the pipeline layouts created from shaders.slang at startup. ahead of time compilers use the same
+// list, so that they warm exactly the shader cache entries the application looks up.
+template <GraphicsApi G>
+[[nodiscard]] const std::map<std::string, ShaderLoader::SlangConfiguration>& GetLayoutConfigurations();
+
+} // namespace shader
+
 template <GraphicsApi G>
 class ShaderModule final : public DeviceObject<G>
 {
@@ -24,18 +24,9 @@ uint32_t CreateLayoutBindings(
 } // namespace shader
 
 template <GraphicsApi G>
-ShaderSet<G> ShaderLoader::Load(const std::filesystem::path& file, const SlangConfiguration& config)
+std::pair<file::LoadFn, file::SaveFn> ShaderLoader::InternalCreateImportFns(
+	const std::filesystem::path& file, const SlangConfiguration& config, ShaderSet<G>& shaderSet)
 {
-	auto shaderSet = ShaderSet<G>{};
-
-	auto loadBin = [&shaderSet](auto& inStream) -> std::error_code
-	{
-		if (auto result = inStream(shaderSet); failure(result))
-			return std::make_error_code(result);
-
-		return {};
-	};
-
 	auto saveBin = [&shaderSet](auto& outStream) -> std::error_code
 	{
 		if (auto result = outStream(shaderSet); failure(result))
@@ -102,7 +93,13 @@ ShaderSet<G> ShaderLoader::Load(const std::filesystem::path& file, const SlangCo
 		std::vector<EntryPoint<G>> entryPoints;
 		for (const auto& [ep, stage] : config.entryPoints)
 		{
-			ENSUREF(spAddEntryPoint(slangRequest, translationUnitIndex, ep.c_str(), stage) == entryPoints.size(), "Failed to add entry point.");
+			if (spAddEntryPoint(slangRequest, translationUnitIndex, ep.c_str(), stage) != entryPoints.size())
+			{
+				std::cerr << "Failed to add entry point: " << ep << ", Path: " << file << '\n';
+				spDestroyCompileRequest(slangRequest);
+				return std::make_error_code(std::errc::invalid_argument);
+			}
+
 			entryPoints.emplace_back("main", shader::GetStageFlag<G>(stage), std::nullopt);
 		}
 
@@ -113,9 +110,9 @@ ShaderSet<G> ShaderLoader::Load(const std::filesystem::path& file, const SlangCo
 
 		if (SLANG_FAILED(compileRes))
 		{
+			std::cerr << "Failed to compile slang file: " << file << '\n';
 			spDestroyCompileRequest(slangRequest);
-
-			ENSUREF(false, "Failed to compile slang file.");
+			return std::make_error_code(std::errc::invalid_argument);
 		}
 
 		int depCount = spGetDependencyFileCount(slangRequest);
@@ -132,9 +129,9 @@ ShaderSet<G> ShaderLoader::Load(const std::filesystem::path& file, const SlangCo
 			if (SLANG_FAILED(
 					spGetEntryPointCodeBlob(slangRequest, &entryPoint - entryPoints.data(), 0, &blob)))
 			{
+				std::cerr << "Failed to get slang blob for entry point: " << std::get<0>(entryPoint) << ", Path: " << file << '\n';
 				spDestroyCompileRequest(slangRequest);
-
-				ENSUREF(false, "Failed to get slang blob.");
+				return std::make_error_code(std::errc::invalid_argument);
 			}
 
 			shaderSet.shaders.emplace_back(std::make_tuple(blob->getBufferSize(), entryPoint));
@@ -192,16 +189,35 @@ ShaderSet<G> ShaderLoader::Load(const std::filesystem::path& file, const SlangCo
 		return {};
 	};
 
-	std::string params, paramsHash;
-	params.append("slang-0.9.3"); // todo: read version from slang header
-	params.append(config.ToString());
-	static constexpr size_t kSha2Size = 32;
-	std::array<uint8_t, kSha2Size> sha2;
-	picosha2::hash256(params.cbegin(), params.cend(), sha2.begin(), sha2.end());
-	picosha2::bytes_to_hex_string(sha2.cbegin(), sha2.cend(), paramsHash);
-	auto loadResult = file::LoadAsset(file, loadSlang, loadBin, saveBin, paramsHash);
+	return {loadSlang, saveBin};
+}
+
+template <GraphicsApi G>
+ShaderSet<G> ShaderLoader::Load(const std::filesystem::path& file, const SlangConfiguration& config)
+{
+	auto shaderSet = ShaderSet<G>{};
+
+	auto loadBin = [&shaderSet](auto& inStream) -> std::error_code
+	{
+		if (auto result = inStream(shaderSet); failure(result))
+			return std::make_error_code(result);
+
+		return {};
+	};
+
+	auto [loadSlang, saveBin] = InternalCreateImportFns<G>(file, config, shaderSet);
+	auto loadResult = file::LoadAsset(file, loadSlang, loadBin, saveBin, InternalGetParametersHash(config));
 
 	ENSUREF(loadResult && !shaderSet.shaders.empty(), "Failed to load shaders.");
 
 	return shaderSet;
 }
+
+template <GraphicsApi G>
+std::expected<file::Record, std::error_code> ShaderLoader::Cook(const std::filesystem::path& file, const SlangConfiguration& config)
+{
+	auto shaderSet = ShaderSet<G>{};
+	auto [loadSlang, saveBin] = InternalCreateImportFns<G>(file, config, shaderSet);
+
+	return file::CookAsset(file, loadSlang, saveBin, InternalGetParametersHash(config));
+}
@@ -3,12 +3,16 @@
 #include "../shaders/capi.h"
 #include "utils.h"
 
+#include <core/application.h>
 #include <core/file.h>
 #include <core/math.h>
 #include <core/std_extra.h>
 
-#include <execution>
+#include <iostream>
+#include <ranges>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -65,76 +69,40 @@ std::tuple<VkImage, VmaAllocation> CreateImage2D(
 }
 
 //NOLINTBEGIN(readability-magic-numbers)
-std::tuple<BufferHandle<kVk>, AllocationHandle<kVk>, ImageCreateDesc<kVk>> Load(
-	const std::filesystem::path& imageFile,
-	const std::shared_ptr<Device<kVk>>& device,
-	std::atomic_uint8_t& progressOut)
+// what an import of an image source file produces. it is only uploaded after a round trip through the asset cache.
+struct ImageSource
 {
-	ZoneScopedN("image::load");
-
-	std::tuple<BufferHandle<kVk>, AllocationHandle<kVk>, ImageCreateDesc<kVk>> initialData;
-
-	auto& [bufferHandle, memoryHandle, desc] = initialData;
-
-	desc.imageAspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
-
-	auto loadBin = [&imageFile, &initialData, &device, &progressOut](auto& inStream) -> std::error_code
-	{
-		progressOut = 32;
-
-		auto& [bufferHandle, memoryHandle, desc] = initialData;
-
-		if (auto result = inStream(desc); failure(result))
-			return std::make_error_code(result);
-
-		thread_local static std::string name; // need to stay alive until the image object is fully constructed
-		name = imageFile.filename().string().append(" loadBin staging");
-		
-		desc.name = name;
-
-		size_t size = 0;
-		for (const auto& mipLevel : desc.mipLevels)
-			size += mipLevel.size;
-
-		auto [locBufferHandle, locMemoryHandle] = CreateBuffer(
-			device->GetAllocator(),
-			size,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			desc.name.data());
-
-		progressOut = 64;
+	ImageCreateDesc<kVk> desc;
+	std::vector<stbi_uc> pixels; // block compressed mip chain
+};
 
-		void* data;
-		VK_CHECK(vmaMapMemory(device->GetAllocator(), locMemoryHandle, &data));
-		auto result = inStream(std::span(static_cast<stbi_uc*>(data), size));
-		vmaUnmapMemory(device->GetAllocator(), locMemoryHandle);
-		if (failure(result))
-			return std::make_error_code(result);
-
-		bufferHandle = locBufferHandle;
-		memoryHandle = locMemoryHandle;
-
-		progressOut = 255;
+std::string GetParametersHash()
+{
+	std::string params;
+	std::string paramsHash;
+	params.append("stb_image-2.26|stb_image_resize-0.96|stb_dxt-1.10"); // todo: read version from stb headers
+	static constexpr size_t kSha2Size = 32;
+	std::array<uint8_t, kSha2Size> sha2;
+	picosha2::hash256(params.cbegin(), params.cend(), sha2.begin(), sha2.end());
+	picosha2::bytes_to_hex_string(sha2.cbegin(), sha2.cend(), paramsHash);
 
-		return {};
-	};
+	return paramsHash;
+}
 
-	auto saveBin = [&initialData, &device, &progressOut](auto& outStream) -> std::error_code
+// loadSourceFileFn and saveBinaryCacheFn of an image import. they only touch source, so they need no device.
+std::pair<file::LoadFn, file::SaveFn> CreateImportFns(
+	const std::filesystem::path& imageFile,
+	ImageSource& source,
+	std::atomic_uint8_t& progressOut)
+{
+	auto saveBin = [&source, &progressOut](auto& outStream) -> std::error_code
 	{
-		auto& [bufferHandle, memoryHandle, desc] = initialData;
+		const auto& [desc, pixels] = source;
 		
 		if (auto result = outStream(desc); failure(result))
 			return std::make_error_code(result);
 
-		size_t size = 0;
-		for (const auto& mipLevel : desc.mipLevels)
-			size += mipLevel.size;
-
-		void* data;
-		VK_CHECK(vmaMapMemory(device->GetAllocator(), memoryHandle, &data));
-		auto result = outStream(std::span(static_cast<const stbi_uc*>(data), size));
-		vmaUnmapMemory(device->GetAllocator(), memoryHandle);
+		auto result = outStream(std::span(pixels.data(), pixels.size()));
 		if (failure(result))
 			return std::make_error_code(result);
 
@@ -143,16 +111,21 @@ std::tuple<BufferHandle<kVk>, AllocationHandle<kVk>, ImageCreateDesc<kVk>> Load(
 		return {};
 	};
 
-	auto loadImage = [&imageFile, &initialData, &device, &progressOut](auto& /*todo: use me: in*/) -> std::error_code
+	auto loadImage = [&imageFile, &source, &progressOut](auto& /*todo: use me: in*/) -> std::error_code
 	{
 		progressOut = 32;
 
-		auto& [bufferHandle, memoryHandle, desc] = initialData;
+		auto& [desc, pixels] = source;
 
 		int width;
 		int height;
 		int channelCount;
 		stbi_uc* stbiImageData = stbi_load(imageFile.string().c_str(), &width, &height, &channelCount, STBI_rgb_alpha);
+		if (stbiImageData == nullptr)
+		{
+			std::cerr << "Failed to load image file: " << stbi_failure_reason() << ", Path: " << imageFile << '\n';
+			return std::make_error_code(std::errc::invalid_argument);
+		}
 
 		uint32_t mipCount =
 			static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
@@ -163,6 +136,7 @@ std::tuple<BufferHandle<kVk>, AllocationHandle<kVk>, ImageCreateDesc<kVk>> Load(
 		name = imageFile.filename().string().append("loadImage staging");
 
 		desc.name = name;
+		desc.imageAspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
 		desc.mipLevels.resize(mipCount);
 		desc.format = channelCount == 4 ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
 		desc.usageFlags = VK_IMAGE_USAGE_SAMPLED_BIT;
@@ -184,22 +158,15 @@ std::tuple<BufferHandle<kVk>, AllocationHandle<kVk>, ImageCreateDesc<kVk>> Load(
 			mipOffset += mipSize;
 		}
 
-		auto [locBufferHandle, locMemoryHandle] = CreateBuffer(
-			device->GetAllocator(),
-			mipOffset,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			desc.name.data());
+		pixels.resize(mipOffset);
 
-		void* stagingBuffer;
-		VK_CHECK(vmaMapMemory(device->GetAllocator(), locMemoryHandle, &stagingBuffer));
+		auto& executor = gApplication.lock()->GetExecutor();
 
-		auto compressBlocks = [](const stbi_uc* src,
+		auto compressBlocks = [&executor](const stbi_uc* src,
 								 unsigned char* dst,
 								 const Extent2d<kVk>& extent,
 								 uint32_t compressedBlockSize,
-								 bool hasAlpha,
-								 uint32_t threadCount)
+								 bool hasAlpha)
 		{
 			auto blockRowCount = extent.height >> 2;
 			auto blockColCount = extent.width >> 2;
@@ -215,32 +182,23 @@ std::tuple<BufferHandle<kVk>, AllocationHandle<kVk>, ImageCreateDesc<kVk>> Load(
 				}
 			};
 
-			std::atomic_uint32_t blockAtomic = 0;
-			std::vector<uint32_t> threadIds(threadCount);
-			std::ranges::iota(threadIds, 0);
-			std::for_each_n(
-				std::execution::par,
-				threadIds.begin(),
-				threadCount,
-				[&](uint32_t /*threadId*/)
+			static constexpr std::size_t kBlockGrainSize = 64;
+			executor.ParallelFor(
+				std::views::iota(0U, blockCount),
+				kBlockGrainSize,
+				[&](uint32_t blockIt)
 				{
-					auto blockIt = blockAtomic++;
-					while (blockIt < blockCount)
-					{
-						auto blockRowIt = blockIt / blockColCount;
-						auto blockColIt = blockIt % blockColCount;
-						auto rowIt = blockRowIt << 2;
-						auto colIt = blockColIt << 2;
-						auto srcOffset = ((rowIt * extent.width) + colIt) * 4;
-						auto dstOffset = blockIt * compressedBlockSize;
+					auto blockRowIt = blockIt / blockColCount;
+					auto blockColIt = blockIt % blockColCount;
+					auto rowIt = blockRowIt << 2;
+					auto colIt = blockColIt << 2;
+					auto srcOffset = ((rowIt * extent.width) + colIt) * 4;
+					auto dstOffset = blockIt * compressedBlockSize;
 
-						std::array<stbi_uc, 64> block;
-						extractBlock(src + srcOffset, extent.width, 4, block.data());
+					std::array<stbi_uc, 64> block;
+					extractBlock(src + srcOffset, extent.width, 4, block.data());
 
-						stb_compress_dxt_block(dst + dstOffset, block.data(), hasAlpha, STB_DXT_HIGHQUAL);
-
-						blockIt = blockAtomic++;
-					}
+					stb_compress_dxt_block(dst + dstOffset, block.data(), hasAlpha, STB_DXT_HIGHQUAL);
 				});
 
 			return blockCount * compressedBlockSize;
@@ -248,12 +206,12 @@ std::tuple<BufferHandle<kVk>, AllocationHandle<kVk>, ImageCreateDesc<kVk>> Load(
 
 		auto threadCount = std::thread::hardware_concurrency();
 		auto* src = stbiImageData;
-		auto* dst = static_cast<unsigned char*>(stagingBuffer);
+		auto* dst = pixels.data();
 
 		auto dprogress = 192 / (2 * desc.mipLevels.size());
 
 		dst += compressBlocks(
-			src, dst, desc.mipLevels[0].extent, compressedBlockSize, hasAlpha, threadCount);
+			src, dst, desc.mipLevels[0].extent, compressedBlockSize, hasAlpha);
 
 		progressOut += 2*dprogress;
 
@@ -275,12 +233,9 @@ std::tuple<BufferHandle<kVk>, AllocationHandle<kVk>, ImageCreateDesc<kVk>> Load(
 			auto threadRowCount = previousExtent.height / threadCount;
 			if (threadRowCount > 4)
 			{
-				std::vector<size_t> threadIds(threadCount);
-				std::ranges::iota(threadIds, 0);
-				std::for_each_n(
-					std::execution::par,
-					threadIds.begin(),
-					threadCount,
+				executor.ParallelFor(
+					std::views::iota(size_t{0}, size_t{threadCount}),
+					1,
 					[&](size_t threadId)
 					{
 						ZoneScopedN("image::loadImage::mip::resize::thread");
@@ -320,30 +275,82 @@ std::tuple<BufferHandle<kVk>, AllocationHandle<kVk>, ImageCreateDesc<kVk>> Load(
 
 			src = mipBuffers[currentBuffer].data();
 			dst +=
-				compressBlocks(src, dst, currentExtent, compressedBlockSize, hasAlpha, threadCount);
+				compressBlocks(src, dst, currentExtent, compressedBlockSize, hasAlpha);
 
 			progressOut += dprogress;
 		}
 
-		vmaUnmapMemory(device->GetAllocator(), locMemoryHandle);
 		stbi_image_free(stbiImageData);
 
+		return {};
+	};
+
+	return {std::move(loadImage), std::move(saveBin)};
+}
+
+std::tuple<BufferHandle<kVk>, AllocationHandle<kVk>, ImageCreateDesc<kVk>> Load(
+	const std::filesystem::path& imageFile,
+	const std::shared_ptr<Device<kVk>>& device,
+	std::atomic_uint8_t& progressOut)
+{
+	ZoneScopedN("image::load");
+
+	std::tuple<BufferHandle<kVk>, AllocationHandle<kVk>, ImageCreateDesc<kVk>> initialData;
+
+	auto& [bufferHandle, memoryHandle, desc] = initialData;
+
+	desc.imageAspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
+
+	auto loadBin = [&imageFile, &initialData, &device, &progressOut](auto& inStream) -> std::error_code
+	{
+		progressOut = 32;
+
+		auto& [bufferHandle, memoryHandle, desc] = initialData;
+
+		if (auto result = inStream(desc); failure(result))
+			return std::make_error_code(result);
+
+		thread_local static std::string name; // need to stay alive until the image object is fully constructed
+		name = imageFile.filename().string().append(" loadBin staging");
+		
+		desc.name = name;
+
+		size_t size = 0;
+		for (const auto& mipLevel : desc.mipLevels)
+			size += mipLevel.size;
+
+		auto [locBufferHandle, locMemoryHandle] = CreateBuffer(
+			device->GetAllocator(),
+			size,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			desc.name.data());
+
+		progressOut = 64;
+
+		void* data;
+		VK_CHECK(vmaMapMemory(device->GetAllocator(), locMemoryHandle, &data));
+		auto result = inStream(std::span(static_cast<stbi_uc*>(data), size));
+		vmaUnmapMemory(device->GetAllocator(), locMemoryHandle);
+		if (failure(result))
+			return std::make_error_code(result);
+
 		bufferHandle = locBufferHandle;
 		memoryHandle = locMemoryHandle;
 
+		progressOut = 255;
+
 		return {};
 	};
 
-	std::string params;
-	std::string paramsHash;
-	params.append("stb_image-2.26|stb_image_resize-0.96|stb_dxt-1.10"); // todo: read version from stb headers
-	static constexpr size_t kSha2Size = 32;
-	std::array<uint8_t, kSha2Size> sha2;
-	picosha2::hash256(params.cbegin(), params.cend(), sha2.begin(), sha2.end());
-	picosha2::bytes_to_hex_string(sha2.cbegin(), sha2.cend(), paramsHash);
-	auto loadResult = file::LoadAsset(imageFile, loadImage, loadBin, saveBin, paramsHash);
+	ImageSource source;
+	auto [loadImage, saveBin] = CreateImportFns(imageFile, source, progressOut);
+
+	// the import and the cache read run on the executor, while this thread helps out with other tasks until they are done
+	auto loadResult = gApplication.lock()->GetExecutor().Join(
+		file::LoadAssetAsync(imageFile, loadImage, loadBin, saveBin, GetParametersHash()));
 
-	ENSUREF(loadResult && bufferHandle != nullptr, "Failed to load image."); //NOLINT(readability-simplify-boolean-expr)
+	ENSUREF(loadResult && *loadResult && bufferHandle != nullptr, "Failed to load image."); //NOLINT(readability-simplify-boolean-expr)
 
 	return initialData;
 }
@@ -692,4 +699,17 @@ std::pair<Image<kVk>, ImageView<kVk>> LoadImage(
 	return result;
 }
 
+template <>
+std::expected<file::Record, std::error_code> CookImage<kVk>(
+	const std::filesystem::path& filePath,
+	std::atomic_uint8_t& progressOut)
+{
+	ZoneScopedN("image::CookImage");
+
+	detail::ImageSource source;
+	auto [loadImage, saveBin] = detail::CreateImportFns(filePath, source, progressOut);
+
+	return file::CookAsset(filePath, loadImage, saveBin, detail::GetParametersHash());
+}
+
 } // namespace image
@@ -3,13 +3,16 @@
 #include "../shaders/capi.h"
 #include "utils.h"
 
+#include <core/application.h>
 #include <core/file.h>
 #include <core/std_extra.h>
 #include <gfx/bounds.h>
 #include <gfx/vertex.h>
 
 #include <cstdint>
+#include <iostream>
 #include <memory>
+#include <utility>
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
@@ -63,108 +66,72 @@ std::vector<VkVertexInputBindingDescription> CalculateInputBindingDescriptions(
 	return {VertexInputBindingDescription<kVk>{0U, stride, VK_VERTEX_INPUT_RATE_VERTEX}};
 }
 
-//NOLINTBEGIN(readability-magic-numbers)
-std::tuple<
-	BufferHandle<kVk>,
-	AllocationHandle<kVk>,
-	BufferHandle<kVk>,
-	AllocationHandle<kVk>,
-	ModelCreateDesc<kVk>>
-Load(
-	const std::filesystem::path& modelFile,
+static constexpr VkBufferUsageFlags kIndexBufferUsageFlags = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+static constexpr VkBufferUsageFlags kVertexBufferUsageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+Buffer<kVk> CreateModelBuffer(
 	const std::shared_ptr<Device<kVk>>& device,
-	std::atomic_uint8_t& progress)
+	TaskCreateInfo<void>& timelineCallbackOut,
+	CommandBufferHandle<kVk> cmd,
+	BufferHandle<kVk> buffer,
+	AllocationHandle<kVk> memory,
+	BufferCreateDesc<kVk>&& desc,
+	bool resident)
 {
-	ZoneScopedN("model::load");
-
-	std::tuple<
-		BufferHandle<kVk>,
-		AllocationHandle<kVk>,
-		BufferHandle<kVk>,
-		AllocationHandle<kVk>,
-		ModelCreateDesc<kVk>> initialData;
-
-	auto& [ibHandle, ibMemHandle, vbHandle, vbMemHandle, desc] = initialData;
-
-	auto loadBin = [&modelFile, &initialData, &device, &progress](auto& inStream) -> std::error_code
+	// resident buffers already hold their data in device local memory, so there is nothing to copy
+	if (resident)
 	{
-		ZoneScopedN("model::loadBin");
-
-		progress = 32;
-
-		auto& [ibHandle, ibMemHandle, vbHandle, vbMemHandle, desc] = initialData;
-		
-		if (auto result = inStream(desc); failure(result))
-			return std::make_error_code(result);
-
-		std::string ibName;
-		std::string vbName;
-		ibName = modelFile.filename().string().append("_staging_ib");
-		vbName = modelFile.filename().string().append("_staging_vb");
-		
-		auto [locIbHandle, locIbMemHandle] = CreateBuffer(
-			device->GetAllocator(),
-			desc.indexCount * sizeof(uint32_t),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			ibName.data());
-
-		void* ibData;
-		VK_CHECK(vmaMapMemory(device->GetAllocator(), locIbMemHandle, &ibData));
-		auto ibResult = inStream(std::span(static_cast<char*>(ibData), desc.indexCount * sizeof(uint32_t)));
-		vmaUnmapMemory(device->GetAllocator(), locIbMemHandle);
-		if (failure(ibResult))
-			return std::make_error_code(ibResult);
-
-		ibHandle = locIbHandle;
-		ibMemHandle = locIbMemHandle;
+		desc.memoryFlags |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
-		progress = 128;
-
-		auto [locVbHandle, locVbMemHandle] = CreateBuffer(
-			device->GetAllocator(),
-			desc.vertexCount * sizeof(VertexP3fN3fT014fC4f),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			vbName.data());
+		return Buffer<kVk>(device, std::make_tuple(buffer, memory), std::forward<BufferCreateDesc<kVk>>(desc));
+	}
 
-		void* vbData;
-		VK_CHECK(vmaMapMemory(device->GetAllocator(), locVbMemHandle, &vbData));
-		auto vbResult = inStream(
-			std::span(static_cast<char*>(vbData), desc.vertexCount * sizeof(VertexP3fN3fT014fC4f)));
-		vmaUnmapMemory(device->GetAllocator(), locVbMemHandle);
-		if (failure(vbResult))
-			return std::make_error_code(vbResult);
+	return Buffer<kVk>(device, timelineCallbackOut, cmd, std::make_tuple(buffer, memory, std::forward<BufferCreateDesc<kVk>>(desc)));
+}
 
-		vbHandle = locVbHandle;
-		vbMemHandle = locVbMemHandle;
+//NOLINTBEGIN(readability-magic-numbers)
+// what an import of a model source file produces. it is only uploaded after a round trip through the asset cache.
+struct ModelSource
+{
+	ModelCreateDesc<kVk> desc;
+	std::vector<uint32_t> indices;
+	std::vector<std::byte> vertices; // VertexP3fN3fT014fC4f
+};
 
-		progress = 255;
+std::string GetParametersHash()
+{
+	std::string params;
+	std::string paramsHash;
+	params.append("tinyobjloader-2.0.15"); // todo: read version from tinyobjloader.h
+	static constexpr size_t kSha2Size = 32;
+	std::array<uint8_t, kSha2Size> sha2;
+	picosha2::hash256(params.cbegin(), params.cend(), sha2.begin(), sha2.end());
+	picosha2::bytes_to_hex_string(sha2.cbegin(), sha2.cend(), paramsHash);
 
-		return {};
-	};
+	return paramsHash;
+}
 
-	auto saveBin = [&initialData, &device, &progress](auto& out) -> std::error_code
+// loadSourceFileFn and saveBinaryCacheFn of a model import. they only touch source, so they need no device.
+std::pair<file::LoadFn, file::SaveFn> CreateImportFns(
+	const std::filesystem::path& modelFile,
+	ModelSource& source,
+	std::atomic_uint8_t& progress)
+{
+	auto saveBin = [&source, &progress](auto& out) -> std::error_code
 	{
 		ZoneScopedN("model::saveBin");
 
-		auto& [ibHandle, ibMemHandle, vbHandle, vbMemHandle, desc] = initialData;
+		const auto& [desc, indices, vertices] = source;
 		
 		if (auto result = out(desc); failure(result))
 			return std::make_error_code(result);
 
-		void* ibData;
-		VK_CHECK(vmaMapMemory(device->GetAllocator(), ibMemHandle, &ibData));
-		auto ibResult = out(std::span(static_cast<const char*>(ibData), desc.indexCount * sizeof(uint32_t)));
-		vmaUnmapMemory(device->GetAllocator(), ibMemHandle);
+		auto ibResult = out(std::span(reinterpret_cast<const char*>(indices.data()), desc.indexCount * sizeof(uint32_t)));
 		if (failure(ibResult))
 			return std::make_error_code(ibResult);
 
-		void* vbData;
-		VK_CHECK(vmaMapMemory(device->GetAllocator(), vbMemHandle, &vbData));
 		auto vbResult = out(std::span(
-			static_cast<const char*>(vbData), desc.vertexCount * sizeof(VertexP3fN3fT014fC4f)));
-		vmaUnmapMemory(device->GetAllocator(), vbMemHandle);
+			reinterpret_cast<const char*>(vertices.data()), desc.vertexCount * sizeof(VertexP3fN3fT014fC4f)));
 		if (failure(vbResult))
 			return std::make_error_code(vbResult);
 
@@ -173,13 +140,13 @@ Load(
 		return {};
 	};
 
-	auto loadOBJ = [&modelFile, &initialData, &device, &progress](auto& /*todo: use me: in*/) -> std::error_code
+	auto loadOBJ = [&modelFile, &source, &progress](auto& /*todo: use me: in*/) -> std::error_code
 	{
 		ZoneScopedN("model::loadOBJ");
 
 		progress = 32;
 
-		auto& [ibHandle, ibMemHandle, vbHandle, vbMemHandle, desc] = initialData;
+		auto& [desc, indices, vertexData] = source;
 
 		using namespace tinyobj;
 		attrib_t attrib;
@@ -187,7 +154,11 @@ Load(
 		std::vector<material_t> materials;
 		std::string warn;
 		std::string err;
-		ENSUREF(tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, modelFile.string().c_str()), "%s", err)
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, modelFile.string().c_str()))
+		{
+			std::cerr << "Failed to load OBJ file: " << err << ", Path: " << modelFile << '\n';
+			return std::make_error_code(std::errc::invalid_argument);
+		}
 
 		progress = 64;
 
@@ -236,8 +207,6 @@ Load(
 		VertexAllocator vertices;
 		vertices.SetStride(sizeof(VertexP3fN3fT014fC4f));
 
-		std::vector<uint32_t> indices;
-
 		ScopedVertexAllocation vertexScope(vertices);
 		vertices.Reserve(indexCount / 3); // guesstimate
 		indices.reserve(indexCount);
@@ -294,61 +263,118 @@ Load(
 
 		progress = 128;
 
-		std::string ibName;
-		std::string vbName;
-		ibName = modelFile.filename().string().append("_staging_ib");
-		vbName = modelFile.filename().string().append("_staging_vb");
-
 		desc.indexCount = indices.size();
 		desc.vertexCount = vertices.Size();
 
+		const auto* vertexBytes = static_cast<const std::byte*>(vertices.Data());
+		vertexData.assign(vertexBytes, vertexBytes + (desc.vertexCount * sizeof(VertexP3fN3fT014fC4f)));
+
+		progress = 224;
+
+		return {};
+	};
+
+	return {std::move(loadOBJ), std::move(saveBin)};
+}
+
+std::tuple<
+	BufferHandle<kVk>,
+	AllocationHandle<kVk>,
+	BufferHandle<kVk>,
+	AllocationHandle<kVk>,
+	ModelCreateDesc<kVk>,
+	bool>
+Load(
+	const std::filesystem::path& modelFile,
+	const std::shared_ptr<Device<kVk>>& device,
+	std::atomic_uint8_t& progress)
+{
+	ZoneScopedN("model::load");
+
+	std::tuple<
+		BufferHandle<kVk>,
+		AllocationHandle<kVk>,
+		BufferHandle<kVk>,
+		AllocationHandle<kVk>,
+		ModelCreateDesc<kVk>,
+		bool> initialData;
+
+	auto& [ibHandle, ibMemHandle, vbHandle, vbMemHandle, desc, resident] = initialData;
+
+	auto loadBin = [&modelFile, &initialData, &device, &progress](auto& inStream) -> std::error_code
+	{
+		ZoneScopedN("model::loadBin");
+
+		progress = 32;
+
+		auto& [ibHandle, ibMemHandle, vbHandle, vbMemHandle, desc, resident] = initialData;
+
+		if (auto result = inStream(desc); failure(result))
+			return std::make_error_code(result);
+
+		// where device local memory can be mapped, the cached data is deserialized straight into the final buffers,
+		// which skips both the staging allocation and the copy on the transfer queue.
+		resident = HasHostVisibleDeviceLocalMemory(device->GetAllocator());
+
+		std::string ibName;
+		std::string vbName;
+		ibName = modelFile.filename().string().append(resident ? "_ib" : "_staging_ib");
+		vbName = modelFile.filename().string().append(resident ? "_vb" : "_staging_vb");
+
+		VkMemoryPropertyFlags memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		if (resident)
+			memoryFlags |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		
 		auto [locIbHandle, locIbMemHandle] = CreateBuffer(
 			device->GetAllocator(),
 			desc.indexCount * sizeof(uint32_t),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			resident ? kIndexBufferUsageFlags : VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			memoryFlags,
 			ibName.data());
 
 		void* ibData;
 		VK_CHECK(vmaMapMemory(device->GetAllocator(), locIbMemHandle, &ibData));
-		memcpy(ibData, indices.data(), desc.indexCount * sizeof(uint32_t));
+		auto ibResult = inStream(std::span(static_cast<char*>(ibData), desc.indexCount * sizeof(uint32_t)));
 		vmaUnmapMemory(device->GetAllocator(), locIbMemHandle);
+		if (failure(ibResult))
+			return std::make_error_code(ibResult);
 
 		ibHandle = locIbHandle;
 		ibMemHandle = locIbMemHandle;
 
-		progress = 192;
+		progress = 128;
 
 		auto [locVbHandle, locVbMemHandle] = CreateBuffer(
 			device->GetAllocator(),
 			desc.vertexCount * sizeof(VertexP3fN3fT014fC4f),
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			resident ? kVertexBufferUsageFlags : VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			memoryFlags,
 			vbName.data());
 
 		void* vbData;
 		VK_CHECK(vmaMapMemory(device->GetAllocator(), locVbMemHandle, &vbData));
-		memcpy(vbData, vertices.Data(), desc.vertexCount * sizeof(VertexP3fN3fT014fC4f));
+		auto vbResult = inStream(
+			std::span(static_cast<char*>(vbData), desc.vertexCount * sizeof(VertexP3fN3fT014fC4f)));
 		vmaUnmapMemory(device->GetAllocator(), locVbMemHandle);
+		if (failure(vbResult))
+			return std::make_error_code(vbResult);
 
 		vbHandle = locVbHandle;
 		vbMemHandle = locVbMemHandle;
 
-		progress = 224;
+		progress = 255;
 
 		return {};
 	};
 
-	std::string params;
-	std::string paramsHash;
-	params.append("tinyobjloader-2.0.15"); // todo: read version from tinyobjloader.h
-	static constexpr size_t kSha2Size = 32;
-	std::array<uint8_t, kSha2Size> sha2;
-	picosha2::hash256(params.cbegin(), params.cend(), sha2.begin(), sha2.end());
-	picosha2::bytes_to_hex_string(sha2.cbegin(), sha2.cend(), paramsHash);
-	auto loadResult = file::LoadAsset(modelFile, loadOBJ, loadBin, saveBin, paramsHash);
+	ModelSource source;
+	auto [loadOBJ, saveBin] = CreateImportFns(modelFile, source, progress);
+
+	// the import and the cache read run on the executor, while this thread helps out with other tasks until they are done
+	auto loadResult = gApplication.lock()->GetExecutor().Join(
+		file::LoadAssetAsync(modelFile, loadOBJ, loadBin, saveBin, GetParametersHash()));
 
-	ENSUREF(loadResult && vbHandle != nullptr && ibHandle != nullptr, "Failed to load model.");
+	ENSUREF(loadResult && *loadResult && vbHandle != nullptr && ibHandle != nullptr, "Failed to load model.");
 
 	return initialData;
 }
@@ -366,31 +392,32 @@ Model<kVk>::Model(
 		AllocationHandle<kVk>,
 		BufferHandle<kVk>,
 		AllocationHandle<kVk>,
-		ModelCreateDesc<kVk>>&& initialData)
-	: myIndexBuffer(
+		ModelCreateDesc<kVk>,
+		bool>&& initialData)
+	: myIndexBuffer(model::detail::CreateModelBuffer(
 		  device,
 		  timelineCallbacksOut[0],
 		  cmd,
-		  std::make_tuple(
-			  std::get<0>(initialData),
-			  std::get<1>(initialData),
-			  BufferCreateDesc<kVk>{
-				  .size = std::get<4>(initialData).indexCount * sizeof(uint32_t),
-				  .usageFlags = VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-				  .memoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				  .name = "IndexBuffer"}))
-	, myVertexBuffer(
+		  std::get<0>(initialData),
+		  std::get<1>(initialData),
+		  BufferCreateDesc<kVk>{
+			  .size = std::get<4>(initialData).indexCount * sizeof(uint32_t),
+			  .usageFlags = model::detail::kIndexBufferUsageFlags,
+			  .memoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			  .name = "IndexBuffer"},
+		  std::get<5>(initialData)))
+	, myVertexBuffer(model::detail::CreateModelBuffer(
 		  device,
 		  timelineCallbacksOut[1],
 		  cmd,
-		  std::make_tuple(
-			  std::get<2>(initialData),
-			  std::get<3>(initialData),
-			  BufferCreateDesc<kVk>{
-				  .size = std::get<4>(initialData).vertexCount * sizeof(VertexP3fN3fT014fC4f),
-				  .usageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-				  .memoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				  .name = "VertexBuffer"}))
+		  std::get<2>(initialData),
+		  std::get<3>(initialData),
+		  BufferCreateDesc<kVk>{
+			  .size = std::get<4>(initialData).vertexCount * sizeof(VertexP3fN3fT014fC4f),
+			  .usageFlags = model::detail::kVertexBufferUsageFlags,
+			  .memoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			  .name = "VertexBuffer"},
+		  std::get<5>(initialData)))
 	, myBindings(model::detail::CalculateInputBindingDescriptions(std::get<4>(initialData).attributes))
 	, myDesc(std::forward<ModelCreateDesc<kVk>>(std::get<4>(initialData)))
 {}
@@ -445,9 +472,11 @@ Model<kVk> LoadModel(
 	// a bit cryptic, but it's just a task that holds on to the old model in its capture group until task is destroyed
 	auto [oldModelDestroyTask, oldModelDestroyFuture] = CreateTask([model = std::move(oldModel)] {});
 
+	// resident models have no copies in flight, but the submit still retires the old model on the transfer timeline
 	std::vector<TaskHandle> timelineCallbacks;
-	timelineCallbacks.emplace_back(transfersDone[0].handle);
-	timelineCallbacks.emplace_back(transfersDone[1].handle);
+	for (const auto& transferDone : transfersDone)
+		if (transferDone.handle)
+			timelineCallbacks.emplace_back(transferDone.handle);
 	timelineCallbacks.emplace_back(oldModelDestroyTask);
 
 	transferQueue.EnqueueSubmit(QueueDeviceSyncInfo<kVk>{
@@ -463,4 +492,17 @@ Model<kVk> LoadModel(
 	return model;
 }
 
+template <>
+std::expected<file::Record, std::error_code> CookModel<kVk>(
+	const std::filesystem::path& filePath,
+	std::atomic_uint8_t& progress)
+{
+	ZoneScopedN("model::CookModel");
+
+	model::detail::ModelSource source;
+	auto [loadOBJ, saveBin] = model::detail::CreateImportFns(filePath, source, progress);
+
+	return file::CookAsset(filePath, loadOBJ, saveBin, model::detail::GetParametersHash());
+}
+
 } // namespace model
@@ -56,8 +56,8 @@ PipelineCacheHandle<kVk> LoadPipelineCache(
 		return {};
 	};
 
-	if (auto fileInfo = GetRecord<false>(cacheFilePath); fileInfo)
-		fileInfo = LoadBinary<false>(cacheFilePath, loadCacheOp);
+	if (auto fileInfo = GetRecord<ChecksumMode::kNone>(cacheFilePath); fileInfo)
+		fileInfo = LoadBinary<ChecksumMode::kNone>(cacheFilePath, loadCacheOp);
 
 	VkPipelineCacheCreateInfo createInfo{.sType=VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
 	createInfo.initialDataSize = cacheData.size();
@@ -123,7 +123,7 @@ std::expected<Record, std::error_code> SavePipelineCache(
 		return {}; // success
 	};
 
-	return SaveBinary<true>(cacheFilePath, saveCacheOp);
+	return SaveBinary<ChecksumMode::kXxh3128>(cacheFilePath, saveCacheOp);
 }
 
 } // namespace pipeline
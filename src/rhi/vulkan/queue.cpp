@@ -6,28 +6,6 @@
 #include <tracy/TracyC.h>
 #include <tracy/TracyVulkan.hpp>
 
-template <>
-bool Queue<kVk>::SubmitCallbacks(TaskExecutor& executor, uint64_t timelineValue) const
-{
-	ZoneScopedN("Queue::SubmitCallbacks");
-
-	TimelineCallbackData callbackData;
-	std::vector<TimelineCallbackData> waitingCallbacks;
-	while (myTimelineCallbacks.try_dequeue(callbackData))
-	{
-		auto& [callbackVector, callbackTimelineValue] = callbackData;
-
-		if (timelineValue <= callbackTimelineValue)
-			waitingCallbacks.emplace_back(std::move(callbackData));
-		else
-			executor.Submit(std::span(callbackVector.data(), callbackVector.size()));
-	}
-
-	myTimelineCallbacks.enqueue_bulk(waitingCallbacks.data(), waitingCallbacks.size());
-
-	return true;
-}
-
 template <>
 Queue<kVk>::Queue(
 	const std::shared_ptr<Device<kVk>>& device,
@@ -121,8 +99,6 @@ Queue<kVk>::~Queue()
 	if (myProfilingContext != nullptr)
 		DestroyVkContext(static_cast<TracyVkCtx>(myProfilingContext));
 #endif
-
-	ASSERT(myTimelineCallbacks.size_approx() == 0);
 }
 
 template <>
@@ -134,9 +110,6 @@ Queue<kVk>& Queue<kVk>::operator=(Queue<kVk>&& other) noexcept
 	myPools = std::exchange(other.myPools, {});
 	myPendingSubmits = std::exchange(other.myPendingSubmits, {});
 	myScratchMemory = std::exchange(other.myScratchMemory, {});
-	std::swap(myTimelineCallbacks, other.myTimelineCallbacks);
-	decltype(other.myTimelineCallbacks) tmp;
-	std::swap(other.myTimelineCallbacks, tmp);
 #if (SPEEDO_PROFILING_LEVEL > 0)
 	std::swap(myProfilingContext, other.myProfilingContext);
 #endif
@@ -152,7 +125,6 @@ void Queue<kVk>::Swap(Queue& other) noexcept
 	std::swap(myPools, other.myPools);
 	std::swap(myPendingSubmits, other.myPendingSubmits);
 	std::swap(myScratchMemory, other.myScratchMemory);
-	std::swap(myTimelineCallbacks, other.myTimelineCallbacks);
 #if (SPEEDO_PROFILING_LEVEL > 0)
 	std::swap(myProfilingContext, other.myProfilingContext);
 #endif
@@ -224,8 +196,6 @@ QueueHostSyncInfo<kVk> Queue<kVk>::Submit()
 		timelineInfo.pSignalSemaphoreValues = pendingSubmit.signalSemaphoreValues.data();
 
 		maxTimelineValue = std::max<uint64_t>(maxTimelineValue, pendingSubmit.timelineValue);
-
-		myTimelineCallbacks.enqueue(std::make_tuple(pendingSubmit.callbacks, maxTimelineValue));
 	}
 
 	auto* submitBegin = reinterpret_cast<SubmitInfo<kVk>*>(timelinePtr);
@@ -258,6 +228,19 @@ QueueHostSyncInfo<kVk> Queue<kVk>::Submit()
 		VK_CHECK(vkQueueSubmit(myQueue, myPendingSubmits.size(), submitBegin, result.fences.back()), reinterpret_cast<uintptr_t>(myQueue));
 	}
 
+	uint64_t callbackTimelineValue = 0ULL;
+	for (auto& pendingSubmit : myPendingSubmits)
+	{
+		callbackTimelineValue = std::max<uint64_t>(callbackTimelineValue, pendingSubmit.timelineValue);
+
+		if (pendingSubmit.callbacks.empty())
+			continue;
+
+		ENSURE(myDesc.completionService != nullptr);
+
+		myDesc.completionService->Enqueue(myDesc.timeline, callbackTimelineValue, std::move(pendingSubmit.callbacks));
+	}
+
 	myPendingSubmits.clear();
 
 	return result;
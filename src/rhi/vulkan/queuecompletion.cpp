@@ -0,0 +1,153 @@
+#include "../queuecompletion.h"
+#include "utils.h"
+
+#include <core/assert.h>
+#include <core/taskexecutor.h>
+
+#include <algorithm>
+#include <span>
+
+template <>
+void QueueCompletionService<kVk>::InternalWake()
+{
+	// needs to be called with myMutex locked, so that host signals are strictly increasing
+	myWakeSemaphore.Signal(++myWakeValue);
+}
+
+template <>
+void QueueCompletionService<kVk>::InternalDrainRegistrations()
+{
+	std::vector<Registration> registrations;
+	{
+		std::unique_lock lock(myMutex);
+		std::swap(registrations, myRegistrations);
+	}
+
+	for (auto& [semaphore, callbacks] : registrations)
+	{
+		auto timelineIt = std::ranges::find(myTimelines, semaphore, &Timeline::semaphore);
+		if (timelineIt == myTimelines.end())
+			timelineIt = myTimelines.emplace(myTimelines.end(), Timeline{.semaphore = semaphore, .pending = {}});
+
+		// submits on the same timeline are almost always enqueued in order, so this is usually an append
+		auto& pending = timelineIt->pending;
+		pending.emplace(
+			std::ranges::upper_bound(pending, callbacks.timelineValue, {}, &PendingCallbacks::timelineValue),
+			std::move(callbacks));
+	}
+}
+
+template <>
+void QueueCompletionService<kVk>::InternalSubmitSignaled()
+{
+	ZoneScopedN("QueueCompletionService::InternalSubmitSignaled");
+
+	std::vector<TaskHandle> ready;
+
+	for (auto& [semaphore, pending] : myTimelines)
+	{
+		if (pending.empty())
+			continue;
+
+		uint64_t value = 0ULL;
+		VK_CHECK(vkGetSemaphoreCounterValue(*myDevice, semaphore, &value));
+
+		auto signaledEnd = std::ranges::upper_bound(pending, value, {}, &PendingCallbacks::timelineValue);
+		for (auto& callbacks : std::ranges::subrange(pending.begin(), signaledEnd))
+			ready.insert(ready.end(), callbacks.callbacks.begin(), callbacks.callbacks.end());
+
+		pending.erase(pending.begin(), signaledEnd);
+	}
+
+	if (!ready.empty())
+		myExecutor.Submit(std::span(ready.data(), ready.size()));
+}
+
+template <>
+void QueueCompletionService<kVk>::InternalRun(std::stop_token stopToken)
+{
+	while (!stopToken.stop_requested())
+	{
+		uint64_t wakeValue = 0ULL;
+		{
+			std::unique_lock lock(myMutex);
+			wakeValue = myWakeValue;
+		}
+
+		InternalDrainRegistrations();
+		InternalSubmitSignaled();
+
+		// any Enqueue (or stop request) after wakeValue was read will signal the wake semaphore past it
+		myWaitSemaphores.clear();
+		myWaitValues.clear();
+		myWaitSemaphores.emplace_back(myWakeSemaphore);
+		myWaitValues.emplace_back(wakeValue + 1);
+
+		for (const auto& [semaphore, pending] : myTimelines)
+		{
+			if (pending.empty())
+				continue;
+
+			myWaitSemaphores.emplace_back(semaphore);
+			myWaitValues.emplace_back(pending.front().timelineValue);
+		}
+
+		{
+			ZoneScopedN("QueueCompletionService::Wait");
+
+			Semaphore<kVk>::Wait(*myDevice, myWaitSemaphores, myWaitValues, false);
+		}
+	}
+}
+
+template <>
+QueueCompletionService<kVk>::QueueCompletionService(const std::shared_ptr<Device<kVk>>& device, TaskExecutor& executor)
+	: myDevice(device)
+	, myExecutor(executor)
+	, myWakeSemaphore(device, SemaphoreCreateDesc<kVk>{.type = VK_SEMAPHORE_TYPE_TIMELINE})
+	, myThread([this](std::stop_token stopToken) { InternalRun(std::move(stopToken)); })
+{}
+
+template <>
+void QueueCompletionService<kVk>::Flush()
+{
+	ZoneScopedN("QueueCompletionService::Flush");
+
+	myThread.request_stop();
+	{
+		std::unique_lock lock(myMutex);
+		InternalWake();
+	}
+	myThread.join();
+
+	InternalDrainRegistrations();
+	InternalSubmitSignaled();
+
+	ASSERT(std::ranges::all_of(myTimelines, [](const auto& timeline) { return timeline.pending.empty(); }));
+}
+
+template <>
+QueueCompletionService<kVk>::~QueueCompletionService()
+{
+	if (myThread.joinable())
+		Flush();
+}
+
+template <>
+void QueueCompletionService<kVk>::Enqueue(SemaphoreHandle<kVk> timeline, uint64_t timelineValue, std::vector<TaskHandle>&& callbacks)
+{
+	ZoneScopedN("QueueCompletionService::Enqueue");
+
+	ENSURE(timeline != nullptr);
+
+	if (callbacks.empty())
+		return;
+
+	std::unique_lock lock(myMutex);
+
+	myRegistrations.emplace_back(Registration{
+		.timeline = timeline,
+		.callbacks = {.timelineValue = timelineValue, .callbacks = std::forward<std::vector<TaskHandle>>(callbacks)}});
+
+	InternalWake();
+}
@@ -211,7 +211,11 @@ void CreateQueues(RHI<kVk>& rhi)
 						.levelCount = 15,
 						.supportsProfiling = static_cast<uint32_t>(queueFamily.timestampValidBits > 0)
 					},
-					QueueCreateDesc<kVk>{.queueIndex = queueIt, .queueFamilyIndex = queueFamilyIt});
+					QueueCreateDesc<kVk>{
+						.queueIndex = queueIt,
+						.queueFamilyIndex = queueFamilyIt,
+						.timeline = graphics->semaphore,
+						.completionService = &rhi.GetQueueCompletionService()});
 			}
 		}
 		else if (isDedicatedQueueFamily(queueFamily, VK_QUEUE_COMPUTE_BIT))
@@ -230,7 +234,11 @@ void CreateQueues(RHI<kVk>& rhi)
 						.levelCount = 1,
 						.supportsProfiling = static_cast<uint32_t>(queueFamily.timestampValidBits > 0)
 					},
-					QueueCreateDesc<kVk>{.queueIndex = queueIt, .queueFamilyIndex = queueFamilyIt});
+					QueueCreateDesc<kVk>{
+						.queueIndex = queueIt,
+						.queueFamilyIndex = queueFamilyIt,
+						.timeline = compute->semaphore,
+						.completionService = &rhi.GetQueueCompletionService()});
 			}
 		}
 		else if (isDedicatedQueueFamily(queueFamily, VK_QUEUE_TRANSFER_BIT))
@@ -249,7 +257,11 @@ void CreateQueues(RHI<kVk>& rhi)
 						.levelCount = 1,
 						.supportsProfiling = VK_FALSE // requires VK_QUEUE_GRAPHICS_BIT or VK_QUEUE_COMPUTE_BIT
 					},
-					QueueCreateDesc<kVk>{.queueIndex = queueIt, .queueFamilyIndex = queueFamilyIt});
+					QueueCreateDesc<kVk>{
+						.queueIndex = queueIt,
+						.queueFamilyIndex = queueFamilyIt,
+						.timeline = transfer->semaphore,
+						.completionService = &rhi.GetQueueCompletionService()});
 			}
 		}
 	}
@@ -418,6 +430,10 @@ RHI<kVk>::RHI(std::string_view name, CreateWindowFunc createWindowFunc)
 	SetWindows(&windowHandle, 1);
 	SetCurrentWindow(windowHandle);
 
+	myQueueCompletionService = std::make_unique<QueueCompletionService<kVk>>(
+		myDevice,
+		Application::Get().lock()->GetExecutor());
+
 	CreateQueues(*this);
 	ConstructWindowDependentObjects(*this);
 }
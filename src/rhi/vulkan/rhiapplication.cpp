@@ -217,6 +217,7 @@ static void DrawMainPass(
 
 		drawThreadCount = std::min<uint32_t>(drawCount, graphicsQueue.GetPool().GetDesc().levelCount);
 
+		// serial on purpose: all partitions allocate from the same command pool, which needs external synchronization
 		constexpr uint32_t kMaxDrawThreads = 128;
 		std::array<uint32_t, kMaxDrawThreads> seq;
 		std::iota(seq.begin(), seq.begin() + drawThreadCount, 0);
@@ -655,6 +656,16 @@ void RHIApplication::PrepareDraw()
 	// so we need to lock :(
 	{
 		std::unique_lock lock(gDrawMutex);
+
+		// config files edited by other processes are applied here, where neither the ui nor the draw task reads them
+		if (window.ReloadConfigIfChanged())
+			LoadIniSettingsFromMemory(window.GetConfig().imguiIniSettings.c_str(), window.GetConfig().imguiIniSettings.size());
+
+		// the device and pipeline configs are only read on creation, so their edits apply on the next start. reloading them
+		// still keeps the save on exit from writing the old values back.
+		rhi.GetDevice()->GetConfig().ReloadIfChanged();
+		rhi.GetPipeline()->GetConfig().ReloadIfChanged();
+
 		Render();
 	}
 
@@ -714,14 +725,12 @@ void RHIApplication::Draw()
 	ZoneScopedN("RHIApplication::Draw");
 
 	std::unique_lock lock(gDrawMutex);
-	std::vector<TaskHandle> frameTasks;
 
 	auto& rhi = GetRHI<kVk>();
 	auto& instance = *rhi.GetInstance();
 	auto& device = *rhi.GetDevice();
 	auto& window = rhi.GetWindow(GetCurrentWindow());
 	auto& pipeline = *rhi.GetPipeline();
-	auto& executor = GetExecutor();
 
 	auto [acquireNextImageFence, acquireNextImageSemaphore, lastFrameIndex, newFrameIndex, flipSuccess] = window.Flip();
 
@@ -740,10 +749,6 @@ void RHIApplication::Draw()
 		auto& [lastGraphicsQueue, lastGraphicsSubmits] = graphics->queues.FetchAdd();
 		auto& [graphicsQueue, graphicsSubmits] = graphics->queues.Get();
 
-		frameTasks.emplace_back(
-			CreateTask([&executor, &queue = graphicsQueue, &semaphore = graphics->semaphore]
-			{ queue.SubmitCallbacks(executor, semaphore.GetValue()); }).handle);
-
 		for (auto& fence : graphicsSubmits.fences)
 			fence.Wait();
 
@@ -932,8 +937,6 @@ void RHIApplication::Draw()
 			graphicsSubmits |= graphicsQueue.Present();
 		}
 	}
-
-	GetExecutor().Submit(frameTasks);
 }
 
 RHIApplication::RHIApplication(
@@ -1072,19 +1075,11 @@ RHIApplication::RHIApplication(
 	ShaderLoader shaderLoader({shaderIncludePath}, {}, shaderIntermediatePath);
 
 	auto shaderSourceFile = shaderIncludePath / "shaders.slang";
+	const auto& shaderLayoutConfigurations = shader::GetLayoutConfigurations<kVk>();
 
 	const auto& [zPrepassShaderLayoutPairIt, zPrepassShaderLayoutWasInserted] = rhi.GetPipelineLayouts().emplace(
 		"VertexZPrepass",
-		rhi.GetPipeline()->CreateLayout(shaderLoader.Load<kVk>(
-			shaderSourceFile,
-			{
-				.sourceLanguage = SLANG_SOURCE_LANGUAGE_SLANG,
-				.target = SLANG_SPIRV,
-				.targetProfile = "SPIRV_1_6",
-				.entryPoints = {{"VertexZPrepass", SLANG_STAGE_VERTEX}},
-				.optimizationLevel = SLANG_OPTIMIZATION_LEVEL_MAXIMAL,
-				.debugInfoLevel = SLANG_DEBUG_INFO_LEVEL_MAXIMAL,
-			})));
+		rhi.GetPipeline()->CreateLayout(shaderLoader.Load<kVk>(shaderSourceFile, shaderLayoutConfigurations.at("VertexZPrepass"))));
 
 	rhi.GetPipeline()->BindLayoutAuto(zPrepassShaderLayoutPairIt->second, VK_PIPELINE_BIND_POINT_GRAPHICS);
 
@@ -1104,20 +1099,7 @@ RHIApplication::RHIApplication(
 
 	const auto& [mainShaderLayoutPairIt, mainShaderLayoutWasInserted] = rhi.GetPipelineLayouts().emplace(
 		"Main",
-		rhi.GetPipeline()->CreateLayout(shaderLoader.Load<kVk>(
-			shaderSourceFile,
-			{
-				.sourceLanguage = SLANG_SOURCE_LANGUAGE_SLANG,
-				.target = SLANG_SPIRV,
-				.targetProfile = "SPIRV_1_6",
-				.entryPoints = {
-					{"VertexMain", SLANG_STAGE_VERTEX},
-					{"FragmentMain", SLANG_STAGE_FRAGMENT},
-					{"ComputeMain", SLANG_STAGE_COMPUTE},
-				},
-				.optimizationLevel = SLANG_OPTIMIZATION_LEVEL_MAXIMAL,
-				.debugInfoLevel = SLANG_DEBUG_INFO_LEVEL_MAXIMAL,
-			})));
+		rhi.GetPipeline()->CreateLayout(shaderLoader.Load<kVk>(shaderSourceFile, shaderLayoutConfigurations.at("Main"))));
 
 	rhi.GetPipeline()->BindLayoutAuto(mainShaderLayoutPairIt->second, VK_PIPELINE_BIND_POINT_GRAPHICS);
 
@@ -1147,6 +1129,10 @@ RHIApplication::RHIApplication(
 	}
 
 	rhi.GetPipeline()->BindLayoutAuto(rhi.GetPipelineLayouts().at("Main"), VK_PIPELINE_BIND_POINT_COMPUTE);
+
+	window.GetConfig().Watch();
+	rhi.GetDevice()->GetConfig().Watch();
+	rhi.GetPipeline()->GetConfig().Watch();
 }
 
 RHIApplication::~RHIApplication() noexcept(false)
@@ -1156,20 +1142,14 @@ RHIApplication::~RHIApplication() noexcept(false)
 	ZoneScopedN("~RHIApplication()");
 
 	auto& rhi = GetRHI<kVk>();
+
+	// don't start any queued imports while shutting down
+	if (gImportCancellation)
+		gImportCancellation.Cancel();
 	
 	rhi.GetDevice()->WaitIdle();
 
-	auto graphics = rhi.GetQueues()[kQueueTypeGraphics].Write();
-	for (auto& [graphicsQueue, graphicsSubmits] : graphics->queues)	
-		graphicsQueue.SubmitCallbacks(GetExecutor(), graphicsSubmits.maxTimelineValue);
-
-	auto compute = rhi.GetQueues()[kQueueTypeCompute].Write();
-	for (auto& [computeQueue, computeSubmits] : compute->queues)	
-		computeQueue.SubmitCallbacks(GetExecutor(), computeSubmits.maxTimelineValue);
-
-	auto transfer = rhi.GetQueues()[kQueueTypeTransfer].Write();
-	for (auto& [transferQueue, transferSubmits] : transfer->queues)	
-		transferQueue.SubmitCallbacks(GetExecutor(), transferSubmits.maxTimelineValue);
+	rhi.GetQueueCompletionService().Flush();
 
 	ShutdownImgui();
 }
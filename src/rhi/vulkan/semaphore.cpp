@@ -112,12 +112,15 @@ bool Semaphore<kVk>::Wait(
 	DeviceHandle<kVk> device,
 	std::span<const SemaphoreHandle<kVk>> semaphores,
 	std::span<const uint64_t> semaphoreValues,
+	bool waitAll,
 	uint64_t timeout)
 {
 	ZoneScopedN("Semaphore::Wait");
 
+	ENSURE(semaphores.size() == semaphoreValues.size());
+
 	VkSemaphoreWaitInfo waitInfo{.sType=VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
-	waitInfo.flags = {};
+	waitInfo.flags = waitAll ? VkSemaphoreWaitFlags{} : VK_SEMAPHORE_WAIT_ANY_BIT;
 	waitInfo.semaphoreCount = semaphores.size();
 	waitInfo.pSemaphores = semaphores.data();
 	waitInfo.pValues = semaphoreValues.data();
@@ -131,3 +134,17 @@ bool Semaphore<kVk>::Wait(
 	return false;
 }
 
+
+template <>
+void Semaphore<kVk>::Signal(uint64_t timelineValue) const
+{
+	ZoneScopedN("Semaphore::Signal");
+
+	ENSURE(GetDesc().type == VK_SEMAPHORE_TYPE_TIMELINE);
+
+	VkSemaphoreSignalInfo signalInfo{.sType=VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO};
+	signalInfo.semaphore = mySemaphore;
+	signalInfo.value = timelineValue;
+
+	VK_CHECK(vkSignalSemaphore(*InternalGetDevice(), &signalInfo));
+}
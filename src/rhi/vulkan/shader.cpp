@@ -317,6 +317,37 @@ uint32_t CreateLayoutBindings<kVk>(
 	return uniformsTotalSize;
 }
 
+template <>
+const std::map<std::string, ShaderLoader::SlangConfiguration>& GetLayoutConfigurations<kVk>()
+{
+	static const std::map<std::string, ShaderLoader::SlangConfiguration> kConfigurations{
+		{"VertexZPrepass",
+		 {
+			 .sourceLanguage = SLANG_SOURCE_LANGUAGE_SLANG,
+			 .target = SLANG_SPIRV,
+			 .targetProfile = "SPIRV_1_6",
+			 .entryPoints = {{"VertexZPrepass", SLANG_STAGE_VERTEX}},
+			 .optimizationLevel = SLANG_OPTIMIZATION_LEVEL_MAXIMAL,
+			 .debugInfoLevel = SLANG_DEBUG_INFO_LEVEL_MAXIMAL,
+		 }},
+		{"Main",
+		 {
+			 .sourceLanguage = SLANG_SOURCE_LANGUAGE_SLANG,
+			 .target = SLANG_SPIRV,
+			 .targetProfile = "SPIRV_1_6",
+			 .entryPoints = {
+				 {"VertexMain", SLANG_STAGE_VERTEX},
+				 {"FragmentMain", SLANG_STAGE_FRAGMENT},
+				 {"ComputeMain", SLANG_STAGE_COMPUTE},
+			 },
+			 .optimizationLevel = SLANG_OPTIMIZATION_LEVEL_MAXIMAL,
+			 .debugInfoLevel = SLANG_DEBUG_INFO_LEVEL_MAXIMAL,
+		 }},
+	};
+
+	return kConfigurations;
+}
+
 } // namespace shader
 
 template <>
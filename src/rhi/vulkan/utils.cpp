@@ -26,6 +26,7 @@
 #include <cstdarg>
 #include <cstdint>
 #include <iostream>
+#include <optional>
 
 PFN_vkGetPhysicalDeviceFeatures2 gVkGetPhysicalDeviceFeatures2{};
 PFN_vkGetPhysicalDeviceProperties2 gVkGetPhysicalDeviceProperties2{};
@@ -378,6 +379,31 @@ FindMemoryType(VkPhysicalDevice device, uint32_t typeFilter, VkMemoryPropertyFla
 	return 0;
 }
 
+bool HasHostVisibleDeviceLocalMemory(VmaAllocator allocator)
+{
+	const VkPhysicalDeviceMemoryProperties* memProperties;
+	vmaGetMemoryProperties(allocator, &memProperties);
+
+	std::optional<uint32_t> largestHeapIndex;
+	for (uint32_t i = 0UL; i < memProperties->memoryHeapCount; i++)
+		if ((memProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0U &&
+			(!largestHeapIndex || memProperties->memoryHeaps[i].size > memProperties->memoryHeaps[*largestHeapIndex].size))
+			largestHeapIndex = i;
+
+	if (!largestHeapIndex)
+		return false;
+
+	constexpr VkMemoryPropertyFlags kFlags =
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	for (uint32_t i = 0UL; i < memProperties->memoryTypeCount; i++)
+		if (memProperties->memoryTypes[i].heapIndex == *largestHeapIndex &&
+			(memProperties->memoryTypes[i].propertyFlags & kFlags) == kFlags)
+			return true;
+
+	return false;
+}
+
 VkFormat FindSupportedFormat(
 	VkPhysicalDevice device,
 	std::span<const VkFormat> candidates,
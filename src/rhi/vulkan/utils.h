@@ -59,6 +59,10 @@ template<typename T>
 [[nodiscard]] uint32_t
 FindMemoryType(VkPhysicalDevice device, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
+// true if the largest device local heap is host visible, i.e. on integrated (UMA) devices and with resizable BAR.
+// the 256MB BAR window of other discrete devices does not count.
+[[nodiscard]] bool HasHostVisibleDeviceLocalMemory(VmaAllocator allocator);
+
 [[nodiscard]] VkFormat
 FindSupportedFormat(
 	VkPhysicalDevice device,
@@ -111,6 +111,24 @@ void Window<kVk>::OnResizeSplitScreenGrid(uint32_t width, uint32_t height)
 	InternalInitializeViews();
 }
 
+template <>
+bool Window<kVk>::ReloadConfigIfChanged()
+{
+	// the swapchain extent and content scale follow the surface, not the file
+	auto swapchainConfig = myConfig.swapchainConfig;
+	auto contentScale = myConfig.contentScale;
+
+	if (!myConfig.ReloadIfChanged())
+		return false;
+
+	myConfig.swapchainConfig = swapchainConfig;
+	myConfig.contentScale = contentScale;
+
+	InternalInitializeViews();
+
+	return true;
+}
+
 template <>
 void Window<kVk>::InternalUpdateViews(const InputState& input)
 {
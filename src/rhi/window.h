@@ -64,6 +64,9 @@ public:
 	void OnResizeFramebuffer(int width, int height);
 	void OnResizeSplitScreenGrid(uint32_t width, uint32_t height);
 
+	// applies changes made to the config file by other processes, once GetConfig().Watch() has been called
+	[[maybe_unused]] bool ReloadConfigIfChanged();
+
 	void UpdateViewBuffer() { InternalUpdateViewBuffer(); }
 
 private:
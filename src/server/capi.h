@@ -20,7 +20,7 @@ extern "C"
 #include <stdbool.h>
 #endif
 
-SERVER_API void ServerCreate(const struct PathConfig* paths);
+SERVER_API void ServerCreate(const struct PathConfig* paths, const struct TaskExecutorConfig* executorConfig, const struct AssetConfig* assetConfig);
 SERVER_API void ServerDestroy(void);
 SERVER_API bool ServerExitRequested();
 
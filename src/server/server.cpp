@@ -126,7 +126,7 @@ Server::Server(std::string_view name, Environment&& env)
 	gRpcTaskState = kTaskStateRunning;
 }
 
-void ServerCreate(const PathConfig* paths)
+void ServerCreate(const PathConfig* paths, const TaskExecutorConfig* executorConfig, const AssetConfig* assetConfig)
 {
 	using namespace server;
 	using namespace file;
@@ -141,14 +141,17 @@ void ServerCreate(const PathConfig* paths)
 	ENSURE(resourcePath);
 	ENSURE(userPath);
 
+	Environment env{{
+		{"RootPath", root.value()},
+		{"ResourcePath", resourcePath.value()},
+		{"UserProfilePath", userPath.value()}
+	}};
+
+	AddEnvironmentVariables(env, executorConfig);
+	AddEnvironmentVariables(env, assetConfig);
+
 	auto appPtr = gServerApplication.Write();
-	appPtr = std::make_shared<Server>(
-		"server",
-		Environment{{
-			{"RootPath", root.value()},
-			{"ResourcePath", resourcePath.value()},
-			{"UserProfilePath", userPath.value()}
-	}});
+	appPtr = std::make_shared<Server>("server", std::move(env));
 
 	appPtr->GetExecutor().Submit({&gRpcTask.handle, 1});
 }
@@ -0,0 +1,175 @@
+#include <core/assetcache.h>
+#include <core/taskexecutor.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace assetcache_test
+{
+
+static constexpr uint64_t kBlobSize = 100;
+
+static std::filesystem::path MakeDirectory()
+{
+	auto directory = std::filesystem::temp_directory_path() / "speedo_tests_assetcache";
+	std::filesystem::remove_all(directory);
+
+	return directory;
+}
+
+// writes a blob to a fresh staging path and publishes it under key, pinned if pin is set
+static void Insert(file::AssetCache& cache, const std::string& key, bool pin = false)
+{
+	auto stagingPath = cache.GetStagingPath(key);
+	{
+		std::ofstream file(stagingPath, std::ios::binary);
+		file << std::string(kBlobSize, key.front());
+
+		REQUIRE(file);
+	}
+
+	auto path = cache.Insert(key, stagingPath);
+	REQUIRE(path);
+	REQUIRE(*path == cache.GetPath(key));
+	REQUIRE(std::filesystem::file_size(*path) == kBlobSize);
+	REQUIRE_FALSE(std::filesystem::exists(stagingPath));
+
+	if (!pin)
+		cache.Unpin(key);
+}
+
+} // namespace assetcache_test
+
+TEST_CASE("AssetCache keys depend on both the checksum and the parameters", "[assetcache]")
+{
+	using file::AssetCache;
+
+	REQUIRE(AssetCache::MakeKey("source", "parameters") == AssetCache::MakeKey("source", "parameters"));
+	REQUIRE(AssetCache::MakeKey("source", "parameters") != AssetCache::MakeKey("source", "other parameters"));
+	REQUIRE(AssetCache::MakeKey("source", "parameters") != AssetCache::MakeKey("other source", "parameters"));
+	REQUIRE(AssetCache::MakeKey("ab", "c") != AssetCache::MakeKey("a", "bc"));
+}
+
+TEST_CASE("AssetCache inserts, replaces and evicts blobs", "[assetcache]")
+{
+	using namespace assetcache_test;
+
+	auto directory = MakeDirectory();
+
+	TaskExecutor executor(2);
+
+	SECTION("staging paths are unique and live in the store")
+	{
+		file::AssetCache cache(directory, 4 * kBlobSize, executor);
+
+		auto first = cache.GetStagingPath("a");
+		auto second = cache.GetStagingPath("a");
+
+		REQUIRE(first != second);
+		REQUIRE(first.parent_path() == cache.GetDirectory());
+		REQUIRE(second.parent_path() == cache.GetDirectory());
+	}
+
+	SECTION("a blob inserted under an existing key replaces it")
+	{
+		file::AssetCache cache(directory, 4 * kBlobSize, executor);
+
+		REQUIRE_FALSE(cache.Touch("a"));
+
+		Insert(cache, "a");
+		Insert(cache, "a");
+
+		REQUIRE(cache.Touch("a"));
+		REQUIRE(cache.Size() == kBlobSize);
+	}
+
+	SECTION("the least recently used blobs are evicted down to the budget")
+	{
+		file::AssetCache cache(directory, 2 * kBlobSize + kBlobSize / 2, executor);
+
+		Insert(cache, "a");
+		Insert(cache, "b");
+		REQUIRE(cache.Touch("a"));
+		Insert(cache, "c"); // over budget, which schedules an eviction in the background
+
+		cache.Evict();
+
+		REQUIRE(cache.Size() == 2 * kBlobSize);
+		REQUIRE_FALSE(cache.Touch("b"));
+		REQUIRE_FALSE(std::filesystem::exists(cache.GetPath("b")));
+		REQUIRE(cache.Touch("a"));
+		REQUIRE(cache.Touch("c"));
+	}
+
+	SECTION("the most recently used blob is kept even if it is over budget on its own")
+	{
+		file::AssetCache cache(directory, kBlobSize / 2, executor);
+
+		Insert(cache, "a");
+		Insert(cache, "b");
+
+		cache.Evict();
+
+		REQUIRE(cache.Size() == kBlobSize);
+		REQUIRE_FALSE(cache.Touch("a"));
+		REQUIRE(cache.Touch("b"));
+	}
+
+	SECTION("pinned blobs are not evicted until they are unpinned")
+	{
+		file::AssetCache cache(directory, kBlobSize + kBlobSize / 2, executor);
+
+		Insert(cache, "a", true);
+		Insert(cache, "b");
+		REQUIRE(cache.Pin("b"));
+		Insert(cache, "c");
+
+		cache.Evict();
+
+		REQUIRE(cache.Size() == 3 * kBlobSize);
+		REQUIRE(std::filesystem::exists(cache.GetPath("a")));
+		REQUIRE(std::filesystem::exists(cache.GetPath("b")));
+
+		cache.Unpin("a");
+		cache.Evict();
+
+		REQUIRE(cache.Size() == 2 * kBlobSize);
+		REQUIRE_FALSE(std::filesystem::exists(cache.GetPath("a")));
+
+		cache.Unpin("b");
+		cache.Evict();
+
+		REQUIRE(cache.Size() == kBlobSize);
+		REQUIRE_FALSE(cache.Touch("b"));
+		REQUIRE(cache.Touch("c"));
+	}
+
+	SECTION("the index survives a restart, and leftover staging files are removed")
+	{
+		std::filesystem::path stagingPath;
+		{
+			file::AssetCache cache(directory, 4 * kBlobSize, executor);
+
+			Insert(cache, "a");
+			Insert(cache, "b");
+
+			stagingPath = cache.GetStagingPath("c");
+			std::ofstream(stagingPath) << "interrupted";
+		}
+
+		file::AssetCache cache(directory, 4 * kBlobSize, executor);
+
+		REQUIRE(cache.Size() == 2 * kBlobSize);
+		REQUIRE(cache.Touch("a"));
+		REQUIRE(cache.Touch("b"));
+		REQUIRE_FALSE(cache.Touch("c"));
+		REQUIRE_FALSE(std::filesystem::exists(stagingPath));
+	}
+
+	std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,78 @@
+#include <core/compression.h>
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace compression_test
+{
+
+static std::vector<std::byte> RoundTrip(const std::vector<std::byte>& src)
+{
+	std::vector<std::byte> encoded(compression::CompressBound(src.size()));
+	auto encodedSize = compression::Compress(src, encoded);
+	REQUIRE(encodedSize != 0);
+
+	std::vector<std::byte> decoded(src.size());
+	REQUIRE(compression::Decompress(std::span(encoded).first(encodedSize), decoded));
+
+	return decoded;
+}
+
+} // namespace compression_test
+
+TEST_CASE("Compress and Decompress round trip", "[compression]")
+{
+	using namespace compression_test;
+
+	std::mt19937 random(1);
+
+	std::vector<std::byte> empty;
+	std::vector<std::byte> repeating(100000, std::byte{7});
+	std::vector<std::byte> noise(100000);
+	std::vector<std::byte> text(100000);
+
+	for (auto& value : noise)
+		value = static_cast<std::byte>(random());
+
+	for (std::size_t byteIt = 0; byteIt < text.size(); byteIt++)
+		text[byteIt] = static_cast<std::byte>("the quick brown fox jumps over the lazy dog "[byteIt % 44] ^ (random() % 16 == 0));
+
+	REQUIRE(RoundTrip(empty) == empty);
+	REQUIRE(RoundTrip(repeating) == repeating);
+	REQUIRE(RoundTrip(noise) == noise);
+	REQUIRE(RoundTrip(text) == text);
+}
+
+TEST_CASE("Compress only writes output that fits", "[compression]")
+{
+	std::vector<std::byte> repeating(100000, std::byte{7});
+	std::vector<std::byte> noise(100000);
+
+	std::mt19937 random(2);
+	for (auto& value : noise)
+		value = static_cast<std::byte>(random());
+
+	std::vector<std::byte> encoded(noise.size() - 1);
+
+	REQUIRE(compression::Compress(repeating, encoded) != 0);
+	REQUIRE(compression::Compress(noise, encoded) == 0);
+}
+
+TEST_CASE("Decompress rejects a wrong size and malformed input", "[compression]")
+{
+	std::vector<std::byte> src(100000, std::byte{7});
+	std::vector<std::byte> encoded(compression::CompressBound(src.size()));
+	auto encodedSize = compression::Compress(src, encoded);
+	REQUIRE(encodedSize != 0);
+	encoded.resize(encodedSize);
+
+	std::vector<std::byte> shorter(src.size() - 1);
+	std::vector<std::byte> longer(src.size() + 1);
+
+	REQUIRE_FALSE(compression::Decompress(encoded, shorter));
+	REQUIRE_FALSE(compression::Decompress(encoded, longer));
+	REQUIRE_FALSE(compression::Decompress(std::span(encoded).first(encodedSize / 2), src));
+}
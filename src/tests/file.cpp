@@ -0,0 +1,241 @@
+#include <core/application.h>
+#include <core/file.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+namespace file_test
+{
+
+static std::vector<std::byte> ReadAll(const std::filesystem::path& filePath)
+{
+	std::ifstream file(filePath, std::ios::binary);
+	std::vector<char> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+	return {reinterpret_cast<const std::byte*>(data.data()), reinterpret_cast<const std::byte*>(data.data() + data.size())};
+}
+
+static void WriteAll(const std::filesystem::path& filePath, const std::vector<std::byte>& data)
+{
+	std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+	REQUIRE(file);
+}
+
+// encodes data as a cache blob, and checks that both the trailer and the decoded data match
+static void RoundTrip(const std::vector<std::byte>& data, compression::Codec codec, std::size_t expectedChunkCount)
+{
+	auto filePath = std::filesystem::temp_directory_path() / "speedo_tests_cacheblob.bin";
+	WriteAll(filePath, data);
+
+	auto encoding = file::detail::EncodeCacheBlob(filePath, codec);
+	REQUIRE(encoding);
+	REQUIRE(encoding->codec == codec);
+	REQUIRE(encoding->size == data.size());
+	REQUIRE(encoding->chunks.size() == expectedChunkCount);
+
+	auto trailer = file::detail::LoadCacheEncoding(filePath);
+	REQUIRE(trailer);
+	REQUIRE(trailer->codec == encoding->codec);
+	REQUIRE(trailer->chunkSize == encoding->chunkSize);
+	REQUIRE(trailer->size == encoding->size);
+	REQUIRE(trailer->chunks == encoding->chunks);
+
+	auto blob = ReadAll(filePath);
+	std::vector<std::byte> decoded;
+
+	auto error = file::detail::DecodeCacheBlob(blob, *encoding, [&decoded](auto& inStream) -> std::error_code
+	{
+		auto remaining = inStream.remaining_data();
+		decoded.assign(remaining.begin(), remaining.end());
+
+		return {};
+	});
+
+	std::filesystem::remove(filePath);
+
+	REQUIRE_FALSE(error);
+	REQUIRE(decoded == data);
+}
+
+static std::vector<std::byte> MakeNoise(std::size_t size)
+{
+	std::mt19937 random(1);
+	std::vector<std::byte> data(size);
+
+	for (auto& value : data)
+		value = static_cast<std::byte>(random());
+
+	return data;
+}
+
+static std::vector<std::byte> MakeText(std::size_t size)
+{
+	static constexpr std::string_view kText = "the quick brown fox jumps over the lazy dog ";
+
+	std::vector<std::byte> data(size);
+
+	for (std::size_t byteIt = 0; byteIt < size; byteIt++)
+		data[byteIt] = static_cast<std::byte>(kText[byteIt % kText.size()]);
+
+	return data;
+}
+
+class TestApplication final : public Application
+{
+public:
+	explicit TestApplication(Environment&& env)
+		: Application("tests", std::forward<Environment>(env))
+	{}
+};
+
+// imports the text file at assetFilePath into the asset cache, or loads it from there. importCountOut counts source file loads.
+static std::vector<std::byte> LoadText(const std::filesystem::path& assetFilePath, uint32_t& importCountOut)
+{
+	std::vector<std::byte> source;
+	std::vector<std::byte> loaded;
+
+	auto loadSourceFileFn = [&source, &importCountOut](auto& inStream) -> std::error_code
+	{
+		auto remaining = inStream.remaining_data();
+		source.assign(remaining.begin(), remaining.end());
+		importCountOut++;
+
+		return {};
+	};
+
+	auto saveBinaryCacheFn = [&source](auto& outStream) -> std::error_code
+	{
+		if (auto result = outStream(source); failure(result))
+			return std::make_error_code(result);
+
+		return {};
+	};
+
+	auto loadBinaryCacheFn = [&loaded](auto& inStream) -> std::error_code
+	{
+		if (auto result = inStream(loaded); failure(result))
+			return std::make_error_code(result);
+
+		return {};
+	};
+
+	auto cache = file::LoadAsset(assetFilePath, loadSourceFileFn, loadBinaryCacheFn, saveBinaryCacheFn, "text");
+	REQUIRE(cache);
+
+	return loaded;
+}
+
+} // namespace file_test
+
+TEST_CASE("Cache blobs round trip through the chunked codec", "[file]")
+{
+	using namespace file_test;
+
+	using enum compression::Codec;
+
+	SECTION("empty")
+	{
+		RoundTrip({}, kLz, 0);
+		RoundTrip({}, kNone, 0);
+	}
+
+	SECTION("incompressible")
+	{
+		auto data = MakeNoise(file::kCacheChunkSize + 1000);
+
+		RoundTrip(data, kLz, 2);
+		RoundTrip(data, kNone, 0);
+	}
+
+	SECTION("exactly one chunk")
+	{
+		auto data = MakeText(file::kCacheChunkSize);
+
+		RoundTrip(data, kLz, 1);
+		RoundTrip(data, kNone, 0);
+	}
+
+	SECTION("multiple chunks")
+	{
+		auto data = MakeText(file::kCacheChunkSize * 2 + file::kCacheChunkSize / 2);
+
+		RoundTrip(data, kLz, 3);
+		RoundTrip(data, kNone, 0);
+	}
+}
+
+TEST_CASE("Cache blobs with a truncated chunk fail to decode", "[file]")
+{
+	using namespace file_test;
+
+	auto data = MakeText(file::kCacheChunkSize * 2);
+	auto filePath = std::filesystem::temp_directory_path() / "speedo_tests_truncatedblob.bin";
+	WriteAll(filePath, data);
+
+	auto encoding = file::detail::EncodeCacheBlob(filePath, compression::Codec::kLz);
+	REQUIRE(encoding);
+
+	auto blob = ReadAll(filePath);
+	std::filesystem::remove(filePath);
+
+	encoding->chunks.back()--;
+
+	auto error = file::detail::DecodeCacheBlob(blob, *encoding, [](auto&) -> std::error_code { return {}; });
+
+	REQUIRE(error == std::make_error_code(std::errc::illegal_byte_sequence));
+}
+
+TEST_CASE("Assets load from the cache through their manifest", "[file]")
+{
+	using namespace file_test;
+
+	auto root = std::filesystem::temp_directory_path() / "speedo_tests_assets";
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+
+	auto assetFilePath = root / "asset.txt";
+	auto data = MakeText(file::kCacheChunkSize + file::kCacheChunkSize / 2);
+	WriteAll(assetFilePath, data);
+
+	bool compressed = GENERATE(true, false);
+	bool touched = GENERATE(false, true);
+
+	{
+		auto app = std::make_shared<TestApplication>(Environment{{
+			{"RootPath", root},
+			{"UserProfilePath", root / ".speedo"},
+			{"AssetCacheCompression", compressed}
+		}});
+		gApplication = app;
+
+		uint32_t importCount = 0;
+
+		REQUIRE(LoadText(assetFilePath, importCount) == data);
+		REQUIRE(importCount == 1);
+
+		// a source file that was only touched validates by its checksum, after which the manifest is saved again
+		if (touched)
+			std::filesystem::last_write_time(assetFilePath, std::filesystem::last_write_time(assetFilePath) + std::chrono::seconds(1));
+
+		REQUIRE(LoadText(assetFilePath, importCount) == data);
+		REQUIRE(LoadText(assetFilePath, importCount) == data);
+		REQUIRE(importCount == 1);
+	}
+
+	std::filesystem::remove_all(root);
+}
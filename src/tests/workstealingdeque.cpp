@@ -0,0 +1,90 @@
+#include <core/workstealingdeque.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("WorkStealingDeque pops newest first and steals oldest first", "[workstealingdeque]")
+{
+	WorkStealingDeque<uint32_t> deque;
+
+	REQUIRE(deque.Empty());
+	REQUIRE_FALSE(deque.Pop());
+	REQUIRE_FALSE(deque.Steal());
+
+	for (uint32_t value = 0; value < 4; value++)
+		deque.Push(value);
+
+	REQUIRE(deque.SizeApprox() == 4);
+	REQUIRE(deque.Pop() == 3U);
+	REQUIRE(deque.Steal() == 0U);
+	REQUIRE(deque.Pop() == 2U);
+	REQUIRE(deque.Steal() == 1U);
+	REQUIRE(deque.Empty());
+	REQUIRE_FALSE(deque.Pop());
+}
+
+TEST_CASE("WorkStealingDeque grows past its initial capacity", "[workstealingdeque]")
+{
+	constexpr uint32_t kCount = 1000;
+
+	WorkStealingDeque<uint32_t> deque(2);
+
+	for (uint32_t value = 0; value < kCount; value++)
+		deque.Push(value);
+
+	REQUIRE(deque.SizeApprox() == kCount);
+	REQUIRE(deque.Steal() == 0U);
+
+	for (uint32_t value = kCount - 1; value > 0; value--)
+		REQUIRE(deque.Pop() == value);
+
+	REQUIRE(deque.Empty());
+}
+
+TEST_CASE("WorkStealingDeque hands every value out exactly once under contention", "[workstealingdeque]")
+{
+	constexpr uint32_t kCount = 100000;
+	constexpr uint32_t kThiefCount = 3;
+
+	WorkStealingDeque<uint32_t> deque(16);
+	std::vector<std::atomic_uint32_t> taken(kCount);
+	std::atomic_bool done = false;
+
+	auto take = [&taken](uint32_t value) { taken[value].fetch_add(1, std::memory_order_relaxed); };
+
+	std::vector<std::thread> thieves;
+	for (uint32_t thiefIt = 0; thiefIt < kThiefCount; thiefIt++)
+	{
+		thieves.emplace_back([&deque, &done, &take]
+		{
+			while (!done.load(std::memory_order_acquire) || !deque.Empty())
+				if (auto value = deque.Steal())
+					take(*value);
+		});
+	}
+
+	// the owner pops every third value itself, so pops and steals race for the last element
+	for (uint32_t value = 0; value < kCount; value++)
+	{
+		deque.Push(value);
+
+		if (value % 3 == 0)
+			if (auto popped = deque.Pop())
+				take(*popped);
+	}
+
+	while (auto value = deque.Pop())
+		take(*value);
+
+	done.store(true, std::memory_order_release);
+
+	for (auto& thief : thieves)
+		thief.join();
+
+	for (const auto& count : taken)
+		REQUIRE(count.load() == 1);
+}